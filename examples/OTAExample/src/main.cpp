@@ -16,6 +16,11 @@ void onMeshReceive(const standard_mesh_message &msg) {
   Serial.print(" ttl="); Serial.println(msg.ttl);
 }
 
+void onOtaStatus(const mesh_ota_status &st) {
+  Serial.printf("[OTA] state=%u progress=%u%% result=%u mesh=%s\n",
+                st.state, st.progress, st.last_result, st.mesh_active ? "on" : "off");
+}
+
 MeshLib mesh(onMeshReceive);
 
 void setup() {
@@ -23,6 +28,7 @@ void setup() {
   delay(200);
 
   mesh.initMesh("ota-node", nullptr, 0, 1);
+  mesh.onOtaStatus(onOtaStatus);
 
   delay(500);
   Serial.printf("Sending ota..\n");
@@ -33,6 +39,6 @@ void setup() {
 }
 
 void loop() {
-  if (mesh.loop()) return; // OTA in progress
+  if (mesh.loop()) return; // OTA image is being written
   delay(10);
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Równolegle obsługiwane zapytania (własne + przekazywane)
+#ifndef MESH_AGG_SESSIONS
+#define MESH_AGG_SESSIONS       4
+#endif
+
+#ifndef MESH_AGG_NAME_MAX
+#define MESH_AGG_NAME_MAX       24
+#endif
+
+// Okno jednego poziomu drzewa: flood zapytania na hop + rozrzut odpowiedzi
+// rodzeństwa (losowo w pierwszej połowie okna)
+#ifndef MESH_AGG_SLOT_MS
+#define MESH_AGG_SLOT_MS        150
+#endif
+
+#define MESH_AGG_MAGIC          0xC4
+
+// ================== TYPY ==================
+
+// Wynik częściowy; count = węzły z wartością, avg = sum / count
+struct mesh_agg_value {
+  uint32_t count;
+  int32_t  min;
+  int32_t  max;
+  int64_t  sum;
+};
+
+struct mesh_agg_result {
+  uint32_t qid;
+  char name[MESH_AGG_NAME_MAX];
+  mesh_agg_value value;
+};
+
+// Odpowiedź do rodzica w drzewie (broadcast, przetwarza tylko rodzic)
+struct mesh_agg_reply {
+  uint8_t  magic;       // MESH_AGG_MAGIC
+  uint8_t  reserved;
+  uint8_t  parent[6];
+  uint32_t qid;
+  uint32_t count;
+  int32_t  min;
+  int32_t  max;
+  int64_t  sum;
+};
+
+struct mesh_agg_stats {
+  uint32_t queries;       // zapytania, w których węzeł uczestniczył
+  uint32_t replies_sent;
+  uint32_t replies_merged;
+  uint32_t replies_late;  // po terminie albo do nieznanego zapytania
+};
+
+// ================== KLASA MeshAggregator ==================
+
+// Agregacja w sieci (w stylu TAG): zapytanie zalewa sieć, rodzicem węzła
+// jest nadawca pierwszej kopii, więc powstaje drzewo po ścieżkach zwrotnych.
+// Węzeł na głębokości d z D odpowiada raz, (D - d) okien po odebraniu
+// zapytania — po dzieciach (d + 1), których wyniki już scalił ze swoją
+// wartością. Źródło (głębokość 0) dostaje jeden wynik po D oknach.
+// Własną wartość wołający dolicza do wyniku z due(). Czysty komponent,
+// czas i losowość z zewnątrz.
+class MeshAggregator {
+public:
+  MeshAggregator();
+
+  static void clear(mesh_agg_value &v);
+  static void add(mesh_agg_value &v, int32_t x);
+  static void merge(mesh_agg_value &into, const mesh_agg_value &other);
+
+  // Źródło zapytania; false gdy brak wolnej sesji
+  bool start(uint32_t qid, const char *name, uint8_t max_depth, uint16_t slot_ms, uint32_t now_ms);
+
+  // Pierwsza kopia zapytania od parent; jitter_ms < slot_ms / 2
+  bool onQuery(uint32_t qid, const char *name, const uint8_t parent[6],
+               uint8_t depth, uint8_t max_depth, uint16_t slot_ms,
+               uint32_t now_ms, uint32_t jitter_ms);
+
+  // Odpowiedź dziecka (już sprawdzone, że adresowana do nas)
+  bool onReply(uint32_t qid, const mesh_agg_value &v, uint32_t now_ms);
+
+  // Sesja po terminie (zwalniana): origin = wynik dla aplikacji, inaczej
+  // wynik poddrzewa do wysłania rodzicowi. false gdy nic nie jest gotowe.
+  bool due(uint32_t now_ms, bool &origin, uint8_t parent[6], mesh_agg_result &result);
+
+  static void toReply(const mesh_agg_result &r, const uint8_t parent[6], mesh_agg_reply &out);
+  static void fromReply(const mesh_agg_reply &in, mesh_agg_value &out);
+
+  bool active(uint32_t qid) const;
+
+  mesh_agg_stats &stats() { return _stats; }
+  const mesh_agg_stats &stats() const { return _stats; }
+
+private:
+  struct Session {
+    bool     used;
+    bool     origin;
+    uint8_t  parent[6];
+    uint32_t qid;
+    uint32_t deadline_ms;
+    char     name[MESH_AGG_NAME_MAX];
+    mesh_agg_value value;
+  };
+
+  Session *_alloc(uint32_t qid);
+
+  Session _sessions[MESH_AGG_SESSIONS];
+  mesh_agg_stats _stats{};
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Sąsiedzi z hello (i tyle samo wpisów w jednym hello)
+#ifndef MESH_BB_NEIGHBORS
+#define MESH_BB_NEIGHBORS       16
+#endif
+
+#ifndef MESH_BB_HELLO_MS
+#define MESH_BB_HELLO_MS        3000
+#endif
+
+// Sąsiad bez hello dłużej niż tyle znika (ok. 3 zgubione hello)
+#ifndef MESH_BB_HOLD_MS
+#define MESH_BB_HOLD_MS         10000
+#endif
+
+// Ostatnie wiadomości, przy których byliśmy liściem — późniejsza kopia od
+// selektora MPR jest wtedy jeszcze przekazywana
+#ifndef MESH_BB_PENDING
+#define MESH_BB_PENDING         8
+#endif
+
+#define MESH_BB_MAGIC           0xC3
+
+#define MESH_BB_SYM             0x01   // wpis: łącze symetryczne (sąsiad słyszy nas)
+#define MESH_BB_MPR             0x02   // wpis: wybrany przez nadawcę na relay
+#define MESH_BB_TRUNCATED       0x01   // hello: tablica pełna, lista niekompletna
+
+// ================== RAMKA HELLO ==================
+
+struct mesh_hello_entry {
+  uint8_t mac[6];
+  uint8_t flags;      // MESH_BB_SYM | MESH_BB_MPR
+};
+
+// Tylko do sąsiadów (bez forwardu, bez dedup)
+struct mesh_hello {
+  uint8_t magic;      // MESH_BB_MAGIC
+  uint8_t flags;      // MESH_BB_TRUNCATED
+  uint8_t count;
+  mesh_hello_entry entries[MESH_BB_NEIGHBORS];
+};
+
+#define MESH_BB_HELLO_LEN(n)  (offsetof(mesh_hello, entries) + size_t(n) * sizeof(mesh_hello_entry))
+
+static_assert(MESH_BB_HELLO_LEN(MESH_BB_NEIGHBORS) <= 250, "hello exceeds ESP-NOW payload");
+static_assert(MESH_BB_NEIGHBORS * MESH_BB_NEIGHBORS < 0xFFFF, "MESH_BB_NEIGHBORS too large");
+
+struct mesh_bb_stats {
+  uint32_t hellos_sent;
+  uint32_t hellos_heard;
+  uint32_t relayed;       // nadawca wybrał nas na MPR
+  uint32_t fallback;      // nadawca bez hello (starsza wersja) / niepełna lista
+  uint32_t suppressed;    // jesteśmy liściem dla tego nadawcy
+  uint32_t late;          // relay po duplikacie od selektora
+};
+
+// ================== KLASA MeshBackbone ==================
+
+// Szkielet relayów w stylu OLSR (multipoint relays). Z hello wiadomo, kto
+// jest sąsiadem symetrycznym i kogo słyszą sąsiedzi (2 hopy). Każdy węzeł
+// wybiera zachłannie najmniejszy zbiór sąsiadów pokrywający wszystkie węzły
+// 2 hopy dalej i ogłasza go w hello. Broadcast przekazuje tylko sąsiad,
+// którego nadawca kopii wybrał na MPR. Czysty komponent, czas z zewnątrz.
+class MeshBackbone {
+public:
+  MeshBackbone();
+
+  void setSelf(const uint8_t mac[6]);
+
+  // true gdy ramka poprawna; new_neighbor = sąsiad dotąd nieznany
+  bool onHello(const uint8_t nb[6], const uint8_t *data, size_t len,
+               uint32_t now_ms, bool *new_neighbor = nullptr);
+
+  // Przelicza MPR-y z aktualnych sąsiadów i buduje hello; zwraca długość
+  size_t buildHello(mesh_hello &out, uint32_t now_ms);
+
+  // To samo w trzech krokach, gdy tablicę zmienia callback odbioru: wybór
+  // MPR (O(N^4)) liczy się na kopii, więc pod blokadą są tylko kopiowanie
+  // (beginSelect) i przepisanie wyniku z budową hello (finishHello)
+  void beginSelect();
+  void select(uint32_t now_ms);
+  size_t finishHello(mesh_hello &out, uint32_t now_ms);
+
+  // Czy przekazać dalej pierwszą kopię odebraną od tx
+  bool shouldRelay(const uint8_t tx[6], uint32_t mid, uint32_t now_ms);
+  // Duplikat od tx: true, gdy przy pierwszej kopii byliśmy liściem, a tx
+  // wybrał nas na MPR (jak w RFC 3626: relay przy pierwszej kopii od
+  // selektora, nie przy pierwszej w ogóle); najwyżej raz na wiadomość
+  bool relayDuplicate(const uint8_t tx[6], uint32_t mid, uint32_t now_ms);
+
+  size_t neighborCount(uint32_t now_ms) const;
+  size_t mprCount() const;        // ilu sąsiadów wybraliśmy
+  size_t selectorCount(uint32_t now_ms) const; // ilu sąsiadów wybrało nas
+
+  mesh_bb_stats &stats() { return _stats; }
+  const mesh_bb_stats &stats() const { return _stats; }
+
+private:
+  struct Neighbor {
+    uint8_t  mac[6];
+    bool     used;
+    bool     sym;          // jego hello wymienia nas
+    bool     selected_us;  // wybrał nas na MPR
+    bool     truncated;    // jego lista sąsiadów jest niekompletna
+    bool     any_sym;      // ma już jakiegoś sąsiada symetrycznego (zbiegł się)
+    bool     mpr;          // my wybraliśmy jego
+    uint8_t  two_hop_count;
+    uint32_t last_ms;
+    uint8_t  two_hop[MESH_BB_NEIGHBORS][6]; // jego symetryczni sąsiedzi
+  };
+
+  bool _fresh(const Neighbor &n, uint32_t now_ms) const {
+    return n.used && uint32_t(now_ms - n.last_ms) <= MESH_BB_HOLD_MS;
+  }
+  int _find(const uint8_t mac[6]) const { return _findIn(_neighbors, mac); }
+  static int _findIn(const Neighbor *table, const uint8_t mac[6]);
+  void _selectMprs(Neighbor *table, uint32_t now_ms);
+
+  uint8_t _self[6];
+  Neighbor _neighbors[MESH_BB_NEIGHBORS];
+  Neighbor _work[MESH_BB_NEIGHBORS];      // kopia do wyboru MPR
+  // ID węzła 2 hopy dalej dla pary (sąsiad, wpis); NONE = nie jest w N2
+  static const uint16_t NONE = 0xFFFF;
+  uint16_t _n2_id[MESH_BB_NEIGHBORS][MESH_BB_NEIGHBORS];
+  uint8_t _covered[(MESH_BB_NEIGHBORS * MESH_BB_NEIGHBORS + 7) / 8];
+  struct LeafMid {
+    bool     used;
+    uint32_t mid;
+  };
+  LeafMid _leaf[MESH_BB_PENDING];
+  uint8_t _leaf_next = 0;
+  mesh_bb_stats _stats{};
+};
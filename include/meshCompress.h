@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== FORMAT ==================
+//
+// LZ77 ze wspólnym słownikiem wstępnym (meshCompressDict.h): okno to
+// [słownik][już zdekodowany payload], więc nawet pierwszy bajt krótkiego
+// payloadu może być kopią. Tokeny:
+//   0LLLLLLL                   → L+1 literałów (1..128) po tokenie
+//   1LLLLDDD DDDDDDDD          → kopia L+3 bajtów (3..18) z odległości D+1
+//
+// Bez sterty i bez bufora roboczego: kompresja przeszukuje payload wprost
+// (≤ 140 B), a słownik przez indeks pierwszego bajtu zapisany we flashu
+// razem ze słownikiem; dekompresja pisze od razu do bufora wyjściowego.
+
+#define MESH_LZ_MIN_MATCH       3
+#define MESH_LZ_MAX_MATCH       (MESH_LZ_MIN_MATCH + 15)
+#define MESH_LZ_MAX_DIST        2048
+#define MESH_LZ_MAX_LITERALS    128
+
+// ================== KLASA MeshLz ==================
+
+class MeshLz {
+public:
+  // 0 = wynik nie mieści się w out_cap (wołający podaje cap < len, żeby
+  // dostać tylko kompresję, która się opłaca)
+  static size_t compress(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap);
+
+  // false = uszkodzony strumień albo wynik dłuższy niż out_cap
+  static bool decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap,
+                         size_t &out_len);
+
+  static size_t dictSize();
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Bufor kopiowania z bieżącej partycji (jedyny większy bufor aplikatora)
+#ifndef MESH_DELTA_BUF
+#define MESH_DELTA_BUF          256
+#endif
+
+// Ile bajtów obrazu przetworzyć w jednym poll() (sprawdzenie bazy, kopie)
+#ifndef MESH_DELTA_POLL_BYTES
+#define MESH_DELTA_POLL_BYTES   8192
+#endif
+
+// ================== FORMAT ŁATKI ==================
+//
+// Nagłówek (little-endian), potem operacje aż do new_size bajtów wyniku:
+//   varint (len << 1) | 0, zigzag-varint przesunięcia  → COPY len bajtów
+//        ze starego obrazu od (koniec poprzedniej kopii + przesunięcie)
+//   varint (len << 1) | 1, len bajtów                  → LITERAL
+
+#define MESH_DELTA_MAGIC        "MDL1"
+#define MESH_DELTA_HASH_LEN     32   // SHA-256
+#define MESH_DELTA_HEADER_LEN   (4 + 4 + 4 + 2 * MESH_DELTA_HASH_LEN)
+
+struct mesh_delta_header {
+  uint32_t old_size;
+  uint32_t new_size;
+  uint8_t  old_hash[MESH_DELTA_HASH_LEN];   // obraz, względem którego liczono łatkę
+  uint8_t  new_hash[MESH_DELTA_HASH_LEN];   // wynik po nałożeniu
+};
+
+enum MeshDeltaResult : uint8_t {
+  MESH_DELTA_MORE = 0,      // w toku
+  MESH_DELTA_OK,            // obraz zapisany i zweryfikowany
+  MESH_DELTA_ERR_FORMAT,    // uszkodzona łatka
+  MESH_DELTA_ERR_BASE,      // bieżący obraz ≠ baza łatki
+  MESH_DELTA_ERR_READ,
+  MESH_DELTA_ERR_WRITE,
+  MESH_DELTA_ERR_HASH       // wynik ≠ new_hash
+};
+
+// ================== SHA-256 ==================
+
+class MeshSha256 {
+public:
+  MeshSha256() { reset(); }
+  void reset();
+  void update(const uint8_t *data, size_t len);
+  void finish(uint8_t out[MESH_DELTA_HASH_LEN]);
+
+private:
+  void _block(const uint8_t *p);
+
+  uint32_t _h[8];
+  uint64_t _len;
+  uint8_t  _buf[64];
+  size_t   _fill;
+};
+
+// ================== WEJŚCIE / WYJŚCIE ==================
+
+// Bieżący obraz (partycja z działającym firmware albo plik na hoście)
+class MeshDeltaSource {
+public:
+  virtual ~MeshDeltaSource() {}
+  virtual uint32_t size() const = 0;
+  virtual bool read(uint32_t offset, uint8_t *buf, size_t len) = 0;
+};
+
+// Partycja docelowa zapisywana sekwencyjnie; end(false) = porzuć obraz
+class MeshDeltaSink {
+public:
+  virtual ~MeshDeltaSink() {}
+  virtual bool begin(uint32_t size) = 0;
+  virtual bool write(const uint8_t *buf, size_t len) = 0;
+  virtual bool end(bool commit) = 0;
+};
+
+// ================== KLASA MeshDeltaApplier ==================
+
+// Strumieniowe nakładanie łatki: stały RAM (MESH_DELTA_BUF + SHA-256), dane
+// łatki dowolnymi kawałkami. Wołający pyta wants(): >0 = tyle bajtów łatki
+// można teraz podać do feed(), 0 = aplikator potrzebuje czasu, wołaj poll()
+// (sprawdzenie bazy, długie kopie — po MESH_DELTA_POLL_BYTES na wywołanie).
+// Sink dostaje commit tylko przy zgodnym new_hash.
+class MeshDeltaApplier {
+public:
+  MeshDeltaApplier() = default;
+
+  void begin(MeshDeltaSource &src, MeshDeltaSink &dst);
+  size_t wants() const;
+  MeshDeltaResult feed(const uint8_t *data, size_t len);
+  MeshDeltaResult poll();
+  void abort();   // przerwany transfer: porzuć zapisany fragment
+
+  const mesh_delta_header &header() const { return _hdr; }
+  uint32_t written() const { return _written; }
+  uint32_t total() const { return _hdr.new_size; }
+
+  static const char *resultName(MeshDeltaResult r);
+  static bool parseHeader(const uint8_t raw[MESH_DELTA_HEADER_LEN], mesh_delta_header &out);
+  static void writeHeader(const mesh_delta_header &hdr, uint8_t raw[MESH_DELTA_HEADER_LEN]);
+
+private:
+  enum Phase : uint8_t { HEADER, BASE, OP, COPY_OFF, COPY, LITERAL, DONE };
+
+  MeshDeltaResult _fail(MeshDeltaResult r);
+  MeshDeltaResult _emit(const uint8_t *data, size_t len);
+  MeshDeltaResult _finishIfDone();
+
+  MeshDeltaSource *_src = nullptr;
+  MeshDeltaSink *_dst = nullptr;
+  Phase _phase = DONE;
+  MeshDeltaResult _result = MESH_DELTA_MORE;
+  mesh_delta_header _hdr{};
+  uint8_t _raw[MESH_DELTA_HEADER_LEN];
+  size_t _raw_fill = 0;
+
+  uint32_t _varint = 0;       // składany varint
+  uint8_t _varint_shift = 0;
+  uint32_t _op_len = 0;       // pozostało w bieżącej operacji
+  uint32_t _copy_pos = 0;     // pozycja w starym obrazie
+  uint32_t _base_pos = 0;     // postęp sprawdzania bazy
+  uint32_t _written = 0;
+
+  MeshSha256 _sha;
+  uint8_t _buf[MESH_DELTA_BUF];
+};
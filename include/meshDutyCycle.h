@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Śpiące dzieci obsługiwane przez jednego rodzica (bit w masce kolejki)
+#ifndef MESH_DC_CHILDREN
+#define MESH_DC_CHILDREN        4
+#endif
+
+// Kolejka rodzica: ramki czekające na pobudkę dzieci (wspólna dla dzieci)
+#ifndef MESH_DC_QUEUE
+#define MESH_DC_QUEUE           8
+#endif
+
+// Subskrypcje dziecka przekazywane rodzicowi w ramce pobudki
+#ifndef MESH_DC_TOPICS
+#define MESH_DC_TOPICS          12
+#endif
+
+// Czas nadania jednej ramki z kolejki — o tyle dziecko wydłuża okno
+#ifndef MESH_DC_FRAME_MS
+#define MESH_DC_FRAME_MS        8
+#endif
+
+// Górna granica okna po wydłużeniu (duża kolejka nie trzyma radia bez końca)
+#ifndef MESH_DC_WINDOW_MAX_MS
+#define MESH_DC_WINDOW_MAX_MS   500
+#endif
+
+// Okno na wysyłkę poza harmonogramem (sendMessage w czasie snu)
+#ifndef MESH_DC_TX_MS
+#define MESH_DC_TX_MS           20
+#endif
+
+// Pobudki bez ACK, po których dziecko szuka nowego rodzica
+#ifndef MESH_DC_PARENT_MISSES
+#define MESH_DC_PARENT_MISSES   3
+#endif
+
+#define MESH_DC_MAGIC           0xC5
+#define MESH_DC_FRAME_MAX       250   // limit ramki ESP-NOW
+
+static_assert(MESH_DC_CHILDREN <= 8, "MESH_DC_CHILDREN must fit the 8-bit queue mask");
+
+// ================== TYPY ==================
+
+enum MeshDcRole : uint8_t {
+  MESH_DC_OFF = 0,
+  MESH_DC_PARENT,     // zawsze włączony, buforuje dla dzieci
+  MESH_DC_SLEEPY      // radio tylko w oknach, nie forwarduje
+};
+
+enum MeshDcAction : uint8_t {
+  MESH_DC_NONE = 0,
+  MESH_DC_WAKE,       // włącz radio i wyślij ramkę pobudki
+  MESH_DC_SLEEP       // wyłącz radio
+};
+
+enum MeshDcKind : uint8_t {
+  MESH_DC_KIND_WAKE = 1,  // dziecko → rodzic: nasłuchuję, oto mój harmonogram
+  MESH_DC_KIND_ACK,       // rodzic → dziecko: przyjęte, count ramek w kolejce
+  MESH_DC_KIND_END        // rodzic → dziecko: kolejka pusta, można spać
+};
+
+#define MESH_DC_WANT_ALL        0x01  // dziecko bez filtra subskrypcji
+
+// Ramka sąsiedzka (bez forwardu), stały rozmiar
+struct mesh_dc_frame {
+  uint8_t  magic;      // MESH_DC_MAGIC
+  uint8_t  kind;       // MeshDcKind
+  uint8_t  peer[6];    // WAKE: wybrany rodzic (zera = dowolny); ACK/END: dziecko
+  uint32_t period_ms;  // WAKE: okres cyklu
+  uint16_t window_ms;  // WAKE: okno nasłuchu
+  uint8_t  count;      // WAKE: liczba topics; ACK: ramek w kolejce
+  uint8_t  flags;      // WAKE: MESH_DC_WANT_ALL
+  uint16_t topics[MESH_DC_TOPICS];
+};
+
+struct mesh_dc_stats {
+  uint32_t wakes;         // dziecko: pobudki; rodzic: odebrane pobudki
+  uint32_t acks;          // dziecko: odebrane ACK; rodzic: wysłane
+  uint32_t buffered;      // rodzic: ramki × dzieci zapisane w kolejce
+  uint32_t delivered;     // rodzic: ramki × dzieci wysłane w oknie
+  uint32_t dropped;       // rodzic: wypchnięte z pełnej kolejki
+  uint32_t children_lost; // rodzic: dziecko bez pobudki dłużej niż 2 okresy
+};
+
+// ================== KLASA MeshDutyCycle ==================
+
+// Skoordynowany sen z rodzicem store-and-forward. Węzeł śpiący budzi się co
+// period_ms na window_ms i ogłasza to rodzicowi (ramka WAKE z harmonogramem
+// i subskrypcjami); rodzic — węzeł zawsze włączony — trzyma w ograniczonej
+// kolejce wiadomości do dziecka (MAC celu) albo pasujące do jego subskrypcji
+// i wysyła je seriami zaraz po pobudce, kończąc ramką END. Opóźnienie
+// dostarczenia ≤ period_ms + czas serii. Czysty komponent, czas z zewnątrz.
+class MeshDutyCycle {
+public:
+  MeshDutyCycle();
+
+  void setSelf(const uint8_t mac[6]);
+  void setRole(MeshDcRole role, uint32_t now_ms);
+  MeshDcRole role() const { return _role; }
+
+  // ---- węzeł śpiący ----
+  void setSchedule(uint32_t period_ms, uint16_t window_ms);
+  void setTopics(const uint16_t *ids, size_t count, bool want_all);
+  MeshDcAction step(uint32_t now_ms);
+  void buildWake(mesh_dc_frame &out) const;
+  bool wakeForSend(uint32_t now_ms);            // true = radio trzeba włączyć
+  bool awake() const { return _awake; }
+  uint32_t sleepMs(uint32_t now_ms) const;      // do następnej pobudki (0 = nie śpi)
+  bool hasParent() const { return _has_parent; }
+  const uint8_t *parent() const { return _parent; }
+
+  // ---- rodzic ----
+  // ramka do buforowania; target = MAC celu komendy albo nullptr,
+  // source = MAC autora (dziecko nie dostaje z powrotem własnych wiadomości)
+  size_t offer(const uint8_t *frame, size_t len, uint16_t topic_id,
+               const uint8_t *target, const uint8_t *source, uint32_t now_ms);
+  // następna ramka serii (z kolejki albo END); 0 = nic do wysłania
+  size_t nextBurst(uint32_t now_ms, uint8_t out[MESH_DC_FRAME_MAX]);
+  size_t childCount() const;
+  size_t queued() const;
+
+  // Ramka MESH_DC_MAGIC od sąsiada; true = odpowiedz reply (ACK rodzica)
+  bool onFrame(const uint8_t from[6], const uint8_t *data, size_t len,
+               uint32_t now_ms, mesh_dc_frame &reply);
+
+  mesh_dc_stats &stats() { return _stats; }
+  const mesh_dc_stats &stats() const { return _stats; }
+
+private:
+  struct Child {
+    bool     used;
+    bool     awake;       // między WAKE a END (albo końcem okna)
+    bool     want_all;
+    uint8_t  mac[6];
+    uint8_t  topic_count;
+    uint16_t topics[MESH_DC_TOPICS];
+    uint32_t period_ms;
+    uint16_t window_ms;
+    uint32_t wake_ms;     // ostatnia pobudka
+  };
+
+  struct Slot {
+    uint8_t  mask;        // dzieci, które jeszcze nie dostały ramki
+    uint8_t  len;
+    uint32_t seq;         // kolejność zapisu (najstarsza wypada pierwsza)
+    uint8_t  data[MESH_DC_FRAME_MAX];
+  };
+
+  bool _onWake(const uint8_t from[6], const mesh_dc_frame &f, uint32_t now_ms, mesh_dc_frame &reply);
+  void _dropChild(size_t idx);
+  void _expire(uint32_t now_ms);
+  bool _wants(const Child &c, uint16_t topic_id) const;
+  size_t _pendingFor(size_t idx) const;
+
+  MeshDcRole _role = MESH_DC_OFF;
+  uint8_t _self[6];
+
+  // węzeł śpiący
+  uint32_t _period_ms = 0;
+  uint16_t _window_ms = 0;
+  uint16_t _topics[MESH_DC_TOPICS];
+  uint8_t _topic_count = 0;
+  bool _want_all = true;
+  bool _awake = false;
+  bool _ack_seen = false;
+  bool _end_seen = false;
+  uint8_t _misses = 0;
+  uint32_t _next_wake_ms = 0;
+  uint32_t _wake_ms = 0;
+  uint32_t _window_end_ms = 0;
+  bool _has_parent = false;
+  uint8_t _parent[6];
+
+  // rodzic
+  Child _children[MESH_DC_CHILDREN];
+  Slot _queue[MESH_DC_QUEUE];
+  uint32_t _seq = 0;
+
+  mesh_dc_stats _stats{};
+};
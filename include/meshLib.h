@@ -4,10 +4,25 @@
 
 #if defined(ARDUINO_ARCH_ESP32)
   #include <WiFi.h>
+  #include <esp_wifi.h>
+  #include <esp_now.h>
 #elif defined(ARDUINO_ARCH_ESP8266)
   #include <ESP8266WiFi.h>
 #endif
 
+#include "meshMac.h"
+#include "meshRateLimit.h"
+#include "meshLinkRate.h"
+#include "meshNetCoding.h"
+#include "meshRetain.h"
+#include "meshTopic.h"
+#include "meshSubFilter.h"
+#include "meshBackbone.h"
+#include "meshDelta.h"
+#include "meshAggregate.h"
+#include "meshDutyCycle.h"
+#include "meshCompress.h"
+
 // ================== KONFIGURACJA / DOMYŚLNE ==================
 
 #ifndef MESH_DEFAULT_TTL
@@ -18,6 +33,44 @@
 #define DEDUP_MAX               100
 #endif
 
+// Network coding: kolejka odroczonych forwardów i czas czekania na parę XOR
+#ifndef MESH_NC_QUEUE
+#define MESH_NC_QUEUE           4
+#endif
+
+#ifndef MESH_NC_HOLD_MS
+#define MESH_NC_HOLD_MS         15
+#endif
+
+// Ramki kompaktowe (ID topicu zamiast 64-bajtowego stringu); odbiór starych
+// ramek działa zawsze, to ustawienie dotyczy tylko wysyłania. Domyślnie
+// wyłączone — węzły ze starszą wersją nie odczytają ramek kompaktowych;
+// włącz, gdy cała sieć ma tę wersję
+#ifndef MESH_COMPACT_FRAMES
+#define MESH_COMPACT_FRAMES     0
+#endif
+
+// Kompresja payloadu w ramkach kompaktowych (LZ ze słownikiem wstępnym);
+// odbiór działa zawsze, wysyłanie domyślnie wyłączone — starsze węzły nie
+// odczytają skompresowanego payloadu
+#ifndef MESH_PAYLOAD_COMPRESSION
+#define MESH_PAYLOAD_COMPRESSION 0
+#endif
+
+// Krótszych payloadów nie warto kompresować
+#ifndef MESH_COMPRESS_MIN_LEN
+#define MESH_COMPRESS_MIN_LEN   12
+#endif
+
+// Tablica topiców znanych z nazwy (wbudowane + subskrypcje + registerTopic)
+#ifndef MESH_TOPIC_TABLE_MAX
+#define MESH_TOPIC_TABLE_MAX    24
+#endif
+
+#ifndef MESH_MAX_SUBSCRIPTIONS
+#define MESH_MAX_SUBSCRIPTIONS  16
+#endif
+
 #ifndef MESH_LIB_LOG_ENABLED
 #define MESH_LIB_LOG_ENABLED    1
 #endif
@@ -36,6 +89,16 @@
 #define MESH_TYPE_DATA          "data"
 #endif
 
+#ifndef MESH_TYPE_RETAIN
+#define MESH_TYPE_RETAIN        "retain"   // "data" z zachowaniem ostatniej wartości
+#endif
+
+// Odpowiedź cache na retain/get: wartość mogła się już zmienić, więc inne
+// cache jej nie nadpisują (zapisują tylko topic, którego nie mają)
+#ifndef MESH_TYPE_RETAIN_REPLAY
+#define MESH_TYPE_RETAIN_REPLAY "retain-replay"
+#endif
+
 #ifndef MESH_TOPIC_DISCOVER_GET
 #define MESH_TOPIC_DISCOVER_GET  "discover/get"
 #endif
@@ -52,6 +115,72 @@
 #define MESH_TOPIC_REBOOT        "reboot"
 #endif
 
+#ifndef MESH_TOPIC_RETAIN_GET
+#define MESH_TOPIC_RETAIN_GET    "retain/get"
+#endif
+
+#ifndef MESH_TOPIC_AGG_QUERY
+#define MESH_TOPIC_AGG_QUERY     "agg/query"
+#endif
+
+// Agregat wbudowany: każdy węzeł odpowiada 1 (count = liczba węzłów)
+#ifndef MESH_AGG_NODES
+#define MESH_AGG_NODES           "nodes"
+#endif
+
+// Agregaty rejestrowane przez aplikację (registerAggregate)
+#ifndef MESH_AGG_FUNCS
+#define MESH_AGG_FUNCS           4
+#endif
+
+// ================== ID TOPICÓW WBUDOWANYCH ==================
+
+constexpr uint16_t MESH_TID_DISCOVER_GET  = meshTopicId(MESH_TOPIC_DISCOVER_GET);
+constexpr uint16_t MESH_TID_DISCOVER_POST = meshTopicId(MESH_TOPIC_DISCOVER_POST);
+constexpr uint16_t MESH_TID_OTA_START     = meshTopicId(MESH_TOPIC_OTA_START);
+constexpr uint16_t MESH_TID_REBOOT        = meshTopicId(MESH_TOPIC_REBOOT);
+constexpr uint16_t MESH_TID_RETAIN_GET    = meshTopicId(MESH_TOPIC_RETAIN_GET);
+constexpr uint16_t MESH_TID_AGG_QUERY     = meshTopicId(MESH_TOPIC_AGG_QUERY);
+
+static_assert(meshTopicIdsUnique(MESH_TID_DISCOVER_GET, MESH_TID_DISCOVER_POST,
+                                 MESH_TID_OTA_START, MESH_TID_REBOOT,
+                                 MESH_TID_RETAIN_GET, MESH_TID_AGG_QUERY),
+              "built-in topic ID collision, rename one of MESH_TOPIC_*");
+
+#ifndef MESH_OTA_CONNECT_TIMEOUT_MS
+#define MESH_OTA_CONNECT_TIMEOUT_MS  15000   // łączenie z AP
+#endif
+
+#ifndef MESH_OTA_TIMEOUT_MS
+#define MESH_OTA_TIMEOUT_MS          300000  // brak aktywności OTA (5 minut)
+#endif
+
+// OTA delta: łatka względem działającego obrazu wysyłana po TCP na ten port
+// (obok ArduinoOTA, który dalej przyjmuje pełny obraz)
+#ifndef MESH_OTA_DELTA
+#define MESH_OTA_DELTA               1
+#endif
+
+#ifndef MESH_OTA_DELTA_PORT
+#define MESH_OTA_DELTA_PORT          3233
+#endif
+
+// Retained: czas oczekiwania na odpowiedź na pierścień (x numer pierścienia)
+#ifndef MESH_RETAIN_WAIT_MS
+#define MESH_RETAIN_WAIT_MS      250
+#endif
+
+// Odstęp między kolejnymi odpowiedziami cache (5/s = domyślny limit "data" per origin)
+#ifndef MESH_RETAIN_REPLY_GAP_MS
+#define MESH_RETAIN_REPLY_GAP_MS 200
+#endif
+
+// Losowe opóźnienie pierwszej odpowiedzi cache (0..N ms); cache, który
+// w tym czasie usłyszy odpowiedź innego, nie odpowiada wcale
+#ifndef MESH_RETAIN_BACKOFF_MS
+#define MESH_RETAIN_BACKOFF_MS   40
+#endif
+
 // ================== STRUKTURA OTA ==================
 
 struct ota_request {
@@ -61,6 +190,34 @@ struct ota_request {
   char ip[16];         // Adres IP hosta OTA (np. "192.168.1.10")
 };
 
+enum MeshOtaState : uint8_t {
+  MESH_OTA_IDLE = 0,     // normalna praca mesh
+  MESH_OTA_CONNECTING,   // łączenie STA z AP (nieblokujące)
+  MESH_OTA_READY,        // ArduinoOTA nasłuchuje, czeka na upload
+  MESH_OTA_UPDATING,     // upload w toku
+  MESH_OTA_DONE,         // obraz zapisany, restart zaplanowany
+  MESH_OTA_FAILED        // błąd/timeout; w następnym loop() powrót do mesh
+};
+
+enum MeshOtaResult : uint8_t {
+  MESH_OTA_RESULT_NONE = 0,
+  MESH_OTA_RESULT_OK,
+  MESH_OTA_RESULT_WIFI_FAILED,
+  MESH_OTA_RESULT_TIMEOUT,
+  MESH_OTA_RESULT_UPLOAD_ERROR,
+  MESH_OTA_RESULT_CANCELLED
+};
+
+struct mesh_ota_status {
+  MeshOtaState  state;
+  MeshOtaResult last_result;  // wynik ostatniej zakończonej próby
+  uint8_t  progress;          // 0..100 w trakcie uploadu
+  uint8_t  upload_error;      // ota_error_t przy MESH_OTA_RESULT_UPLOAD_ERROR
+  bool     mesh_active;       // czy ESP-NOW działa równolegle z OTA
+  MeshDeltaResult delta_result; // ostatnia łatka delta (MESH_DELTA_MORE = brak)
+  uint32_t state_ms;          // czas w bieżącym stanie
+};
+
 // ================== STRUKTURA WIADOMOŚCI ==================
 
 struct standard_mesh_message {
@@ -72,11 +229,55 @@ struct standard_mesh_message {
   uint32_t mid;       // NOWE: Message ID do deduplikacji
 };
 
+// ================== RAMKA KOMPAKTOWA ==================
+
+#define MESH_CF_MAGIC           0xC1
+#define MESH_CF_TYPE_MASK       0x03
+#define MESH_CF_TYPE_DATA       0x00
+#define MESH_CF_TYPE_CMD        0x01
+#define MESH_CF_TYPE_RETAIN     0x02
+#define MESH_CF_TYPE_REPLAY     0x03
+#define MESH_CF_TOPIC_INLINE    0x04   // topic jako string (topic dynamiczny)
+#define MESH_CF_COMPRESSED      0x08   // payload skompresowany (MeshLz)
+
+struct mesh_compact_frame {
+  uint8_t  magic;        // MESH_CF_MAGIC
+  int8_t   ttl;          // jedyne pole zmieniane przez relaye
+  uint8_t  flags;        // typ + MESH_CF_TOPIC_INLINE / MESH_CF_COMPRESSED
+  uint8_t  payload_len;  // w ramce (po kompresji)
+  uint32_t mid;
+  uint8_t  sender[6];    // MAC binarnie
+  uint16_t topic_id;     // meshTopicId(topic)
+  uint8_t  data[sizeof(standard_mesh_message::topic) +
+                sizeof(standard_mesh_message::payload)]; // [topic\0][payload]
+};
+
+#define MESH_CF_HEADER_LEN      offsetof(mesh_compact_frame, data)
+
+// mesh_coded_frame::flags — format, w jakim przyszły zakodowane wiadomości
+#define MESH_NC_A_COMPACT       0x01
+#define MESH_NC_A_INLINE        0x02
+#define MESH_NC_B_COMPACT       0x04
+#define MESH_NC_B_INLINE        0x08
+#define MESH_NC_A_COMPRESSED    0x10
+#define MESH_NC_B_COMPRESSED    0x20
+
+static_assert(sizeof(mesh_compact_frame) < sizeof(standard_mesh_message),
+              "compact frame must be distinguishable from legacy by length");
+
+static_assert(offsetof(standard_mesh_message, ttl) == MESH_NC_BODY_LEN,
+              "MESH_NC_BODY_LEN must cover sender/type/topic/payload");
+static_assert(sizeof(standard_mesh_message) == MESH_NC_LEGACY_LEN,
+              "MESH_NC_LEGACY_LEN must match the legacy frame length");
+
 // ================== KLASA MeshLib ==================
 
 class MeshLib {
 public:
   using ReceiveCallback = void(*)(const standard_mesh_message&);
+  using OtaCallback = void(*)(const mesh_ota_status&);
+  using AggregateValueFn = bool(*)(int32_t &value);   // false = brak wartości na węźle
+  using AggregateCallback = void(*)(const mesh_agg_result&);
   explicit MeshLib(ReceiveCallback cb);
 
   void initMesh(const char *name,
@@ -88,9 +289,71 @@ public:
   bool sendMessage(const char *topic, const char *payload, int ttl = -1);
   bool sendCmd(const char *topic, const char *payload, int ttl = -1);
   bool sendDiscover(int ttl);
+
+  // Topic znany z nazwy leci w ramce jako samo 16-bitowe ID. Wskaźnik musi
+  // żyć tak długo jak obiekt (jak lista subskrypcji). false przy kolizji ID
+  // i dla "#xxxx" (składnia zarezerwowana na surowe ID).
+  bool registerTopic(const char *topic);
+  void setCompactFrames(bool enabled) { _compact_frames = enabled; }
+  // Payload kompresowany tylko gdy ramka wyjdzie krótsza; wszystkie węzły
+  // muszą mieć tę wersję biblioteki (ten sam słownik)
+  void setPayloadCompression(bool enabled) { _compress_payloads = enabled; }
+
+  // Retained: ostatnia wartość topicu trzymana przez węzły-cache
+  bool sendRetained(const char *topic, const char *payload, int ttl = -1);
+  void setRetainCache(bool enabled);
+  bool requestRetained(const char *topic = nullptr); // nullptr = wszystkie topici
+  const MeshRetainStore &retainStore() const { return _retain; }
   
   // OTA support (managed internally)
-  bool loop();      // tick function; handles OTA when active
+  bool loop();      // tick function; steps OTA state machine, never blocks
+
+  mesh_ota_status otaStatus() const;
+  void onOtaStatus(OtaCallback cb) { _ota_callback = cb; } // zmiany stanu/postępu, z loop()
+  bool cancelOTA(); // przerwij OTA i wróć do mesh bez restartu
+
+  // Limitowanie forwardów: token bucket per origin + globalny budżet airtime
+  void setForwardLimit(MeshPriority prio, uint16_t rate, uint16_t burst);
+  void setAirtimeBudget(uint16_t permille,
+                        uint16_t data_reserve_permille = MESH_AIRTIME_DATA_RESERVE_PERMILLE);
+  void setRateLimitEnabled(bool enabled);
+  const MeshRateLimiter &rateLimiter() const { return _limiter; } // statystyki shed
+
+  // Adaptacyjny rate/moc ESP-NOW na podstawie RSSI i dostarczeń (tylko ESP32)
+  bool setAdaptiveRate(bool enabled);
+  void setLinkConfig(const mesh_link_config &cfg);
+  const MeshLinkRate &linkRate() const { return _link; }
+
+  // Forward z kodowaniem sieciowym (COPE): dwie oczekujące wiadomości w jednej
+  // ramce XOR. Musi być włączone na wszystkich węzłach.
+  void setNetworkCoding(bool enabled);
+  const mesh_nc_stats &netCodingStats() const { return _coder.stats(); }
+
+  // Przycinanie floodu "data": forward tylko gdy ktoś dalej subskrybuje topic
+  // (filtry Blooma ogłaszane sąsiadom). Sąsiad bez filtra = pełny flood.
+  void setSubscriptionPruning(bool enabled);
+  const mesh_sf_stats &subPruningStats() const { return _subfilter.stats(); }
+
+  // Szkielet relayów (OLSR MPR z hello): forwardują tylko węzły wybrane przez
+  // nadawcę kopii, reszta jest liściem. Węzły bez hello = pełny flood.
+  void setBackbone(bool enabled);
+  const MeshBackbone &backbone() const { return _backbone; }
+
+  // Agregacja w sieci: zapytanie po nazwie agregatu, węzły scalają wyniki
+  // poddrzewa (count/min/max/sum) i odpowiadają raz, wzdłuż drzewa do źródła.
+  // Funkcja wartości i callback wołane z loop(). Wynik po ttl * MESH_AGG_SLOT_MS.
+  bool registerAggregate(const char *name, AggregateValueFn fn); // name żyje jak obiekt
+  void onAggregate(AggregateCallback cb) { _agg_callback = cb; }
+  uint32_t queryAggregate(const char *name, int ttl = -1);       // qid, 0 = błąd
+  const mesh_agg_stats &aggregateStats() const { return _agg.stats(); }
+
+  // Skoordynowany sen (po initMesh): węzeł śpiący włącza radio co period_ms
+  // na window_ms i nie forwarduje; rodzic (zawsze włączony) buforuje dla
+  // niego wiadomości i wysyła je zaraz po pobudce. Jedna rola na węzeł.
+  void setSleepy(uint32_t period_ms, uint16_t window_ms); // period_ms = 0 → wyłącz
+  void setSleepParent(bool enabled);
+  uint32_t sleepMs() const { return _dc.sleepMs(millis()); } // do pobudki, np. na light sleep
+  const MeshDutyCycle &dutyCycle() const { return _dc; }
 
 private:
   // instancja singletona dla callbacków ESP-NOW
@@ -103,9 +366,30 @@ private:
   const char **_subscribed_topics = nullptr;
   int _topics_count = 0;
   uint8_t _channel = 1;
+  bool _power_save = false;
 
   ReceiveCallback _callback = nullptr;
 
+  // ---- ID TOPICÓW / FORMAT RAMEK ----
+  struct TopicEntry {
+    uint16_t id;
+    const char *name;
+  };
+
+  // Jak wiadomość przyszła / ma zostać wysłana
+  struct FrameMeta {
+    uint16_t topic_id;
+    bool compact;        // ramka kompaktowa (inaczej standard_mesh_message)
+    bool topic_inline;   // string topicu był w ramce
+    bool compressed;     // payload kompresowany (jeśli się opłaca)
+  };
+
+  TopicEntry _topic_table[MESH_TOPIC_TABLE_MAX]{};
+  int _topic_table_count = 0;
+  uint16_t _sub_ids[MESH_MAX_SUBSCRIPTIONS]{};
+  bool _compact_frames = MESH_COMPACT_FRAMES;
+  bool _compress_payloads = MESH_PAYLOAD_COMPRESSION;
+
   // ---- DEDUP po MID ----
   struct DedupEntry {
     uint32_t mid;  // zapamiętany MID; 0 oznacza pusty slot
@@ -114,10 +398,89 @@ private:
   DedupEntry _dedup[DEDUP_MAX]{};
   int _dedup_idx = 0;
 
+  // ---- LIMITER FORWARDÓW ----
+  MeshRateLimiter _limiter;
+
+  // ---- ADAPTACYJNY RATE ----
+  MeshLinkRate _link;
+  bool _adaptive_rate = false;
+  MeshPhyRate _cur_rate = MESH_PHY_COUNT; // MESH_PHY_COUNT = nieznany
+  int8_t _cur_power_q = 0;
+
+  // ---- NETWORK CODING ----
+  struct PendingForward {
+    standard_mesh_message msg;
+    FrameMeta meta;
+    uint32_t due_ms;
+    bool used;
+  };
+
+  MeshNetCoder _coder;
+  bool _net_coding = false;
+  PendingForward _fwd_queue[MESH_NC_QUEUE]{};
+
+  // ---- PRZYCINANIE FLOODU ----
+  MeshSubFilter _subfilter;
+  bool _sub_pruning = false;
+  volatile bool _sf_changed = false;     // nowe ogłoszenie sąsiada
+  unsigned long _sf_advert_time = 0;
+  unsigned long _sf_advert_gap = 0;
+
+  // ---- SZKIELET RELAYÓW ----
+  MeshBackbone _backbone;
+  bool _backbone_on = false;
+  volatile bool _bb_changed = false;     // nowy sąsiad
+  unsigned long _bb_hello_time = 0;
+  unsigned long _bb_hello_gap = 0;
+
+  // ---- AGREGACJA ----
+  struct AggregateEntry {
+    const char *name;
+    AggregateValueFn fn;
+  };
+
+  MeshAggregator _agg;
+  AggregateEntry _agg_fns[MESH_AGG_FUNCS]{};
+  int _agg_fn_count = 0;
+  AggregateCallback _agg_callback = nullptr;
+
+  // ---- SKOORDYNOWANY SEN ----
+  MeshDutyCycle _dc;
+  unsigned long _dc_burst_time = 0;
+
+  // ---- RETAINED ----
+  struct RetainReply {
+    bool active;
+    bool started;                       // wysłano już pierwszy wpis
+    int16_t ttl;
+    uint32_t after;                     // seq ostatnio wysłanego wpisu
+    uint32_t upto;                      // migawka: seq ostatniego wpisu przy zapytaniu
+    unsigned long next_ms;
+    char filter[MESH_RETAIN_TOPIC_MAX]; // pusty = wszystkie
+  };
+
+  MeshRetainStore _retain;
+  bool _retain_cache = false;
+  RetainReply _retain_reply{};
+  // zapytanie z rosnącym TTL: najbliższy cache odpowiada pierwszy
+  uint8_t _retain_ring = 0;             // 0 = brak zapytania w toku
+  volatile bool _retain_answered = false;
+  unsigned long _retain_ring_time = 0;
+  char _retain_filter[MESH_RETAIN_TOPIC_MAX] = {0};
+
   // OTA state
-  bool _ota_mode = false;
-  unsigned long _ota_start_time = 0;
-  const unsigned long OTA_TIMEOUT_MS = 300000; // 5 minut
+  MeshOtaState _ota_state = MESH_OTA_IDLE;
+  MeshOtaResult _ota_result = MESH_OTA_RESULT_NONE;
+  unsigned long _ota_state_time = 0;    // wejście w bieżący stan
+  unsigned long _ota_activity_time = 0; // ostatnia aktywność OTA (timeout)
+  uint8_t _ota_progress = 0;
+  uint8_t _ota_upload_error = 0;
+  bool _ota_begun = false;              // ArduinoOTA.begin() już wywołane
+  bool _espnow_active = false;
+  OtaCallback _ota_callback = nullptr;
+  MeshDeltaApplier _delta;
+  bool _delta_active = false;           // łatka delta w trakcie nakładania
+  MeshDeltaResult _delta_result = MESH_DELTA_MORE;
 
   // Defer switching from ESP-NOW callback to main loop
   volatile bool _ota_pending = false;
@@ -135,28 +498,79 @@ private:
   // wewnętrzne: thunk + obsługa odbioru
 #if defined(ARDUINO_ARCH_ESP32)
   static void _recvThunk(const uint8_t *mac, const uint8_t *data, int len);
+  static void _promiscThunk(void *buf, wifi_promiscuous_pkt_type_t type);
 #else
   static void _recvThunk(uint8_t *mac, uint8_t *data, uint8_t len);
 #endif
 
   void _handleReceive(const uint8_t *mac, const uint8_t *data, int len);
-  void _autoHandleCmd(standard_mesh_message &msg);
+  void _processMessage(const uint8_t *mac, standard_mesh_message &msg, const FrameMeta &meta);
+  void _forward(const uint8_t *mac, standard_mesh_message &msg, const FrameMeta &meta, bool late);
+  void _handleCoded(const uint8_t *mac, const mesh_coded_frame &frame, size_t len);
+  void _codedBody(const standard_mesh_message &msg, const FrameMeta &meta,
+                  standard_mesh_message &out) const;
+  bool _queueForward(const standard_mesh_message &msg, const FrameMeta &meta);
+  void _flushForwards();
+  static void _selfMac(uint8_t out[6]);
+  void _autoHandleCmd(const uint8_t *mac, standard_mesh_message &msg, const FrameMeta &meta);
   void _sendDiscoverPost();
+  void _onRetained(const standard_mesh_message &msg, bool replay = false);
+  void _handleRetainRequest(const standard_mesh_message &msg);
+  bool _sendRetainGet();
+  void _stepRetain();
+  void _stepSubAdvert();
+  void _stepHello();
+  void _handleAggQuery(const uint8_t *mac, const standard_mesh_message &msg);
+  void _handleAggReply(const mesh_agg_reply &reply);
+  bool _aggValue(const char *name, int32_t &value) const;
+  void _stepAggregate();
+  void _offerSleepy(const standard_mesh_message &msg, const FrameMeta &meta);
+  void _stepDutyCycle();
+  void _radioSleep();
+  void _radioWake();
   void _fillSender(standard_mesh_message &msg) const;
   void _fillMid(standard_mesh_message &msg);
   static bool _equals(const char *a, const char *b);
   bool _parseTargetMac(const char *payload, char *out_mac, size_t mac_size) const;
   bool _isForUs(const char *target_mac) const;
+  bool _admitForward(const uint8_t *mac, const standard_mesh_message &msg, const FrameMeta &meta);
+  void _applyTxRate();
+  uint32_t _txKbps();
+  void _stepLinkRate();
   void _handleOTARequest(const standard_mesh_message &msg);
   void _handleRebootRequest(const standard_mesh_message &msg);
+  void _configureRadio();
+  bool _startEspNow();
+  void _stopEspNow();
   void _enterOTAMode(const char *ssid, const char *passwd, const char *ip);
-  void _handleOTA(); // call periodically when in OTA mode
-  void _exitOTAMode(); // powrót do mesh'u
+  void _handleOTA(); // krok maszyny stanów OTA, wołany z loop()
+  void _otaConnected();
+  void _otaSetState(MeshOtaState state);
+  void _otaFail(MeshOtaResult result);
+  void _otaNotify();
+  void _exitOTAMode(); // powrót do mesh'u bez restartu
+  void _stepDelta();
+  void _deltaEnd(MeshDeltaResult result);
   void _doReboot();
 
   bool _sendMessage(const standard_mesh_message &message);
+  bool _echoExpected(const standard_mesh_message &msg) const;
+  int _sendRaw(const uint8_t *dest, const uint8_t *data, size_t len); // 0 = OK
+  int _sendFrame(const standard_mesh_message &msg, const FrameMeta &meta);
+  size_t _encodeFrame(const standard_mesh_message &msg, const FrameMeta &meta,
+                      uint8_t out[MESH_DC_FRAME_MAX]) const;
+  size_t _encodeCompact(const standard_mesh_message &msg, const FrameMeta &meta,
+                        mesh_compact_frame &out) const; // 0 = nie da się
+  bool _decodeCompact(const uint8_t *data, int len,
+                      standard_mesh_message &msg, FrameMeta &meta) const;
+  size_t _frameLen(const standard_mesh_message &msg, const FrameMeta &meta) const;
+  void _topicMeta(const char *topic, FrameMeta &meta) const;
+  static bool _rawTopicId(const char *topic, uint16_t &id);
+  const char *_topicName(uint16_t id) const;
+  bool _topicIs(const FrameMeta &meta, const standard_mesh_message &msg, uint16_t id) const;
 
   // dedup
+  bool _seen(uint32_t mid) const;
   bool _seenAndRemember(const standard_mesh_message &m);
 };
 
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+#ifndef MESH_LINK_MAX_NEIGHBORS
+#define MESH_LINK_MAX_NEIGHBORS   16
+#endif
+
+// Sąsiad niesłyszany dłużej niż tyle nie wpływa na wybór rate dla broadcastu
+#ifndef MESH_LINK_STALE_MS
+#define MESH_LINK_STALE_MS        60000
+#endif
+
+// Zapas ponad próg czułości wybranego rate (dB)
+#ifndef MESH_LINK_MARGIN_DB
+#define MESH_LINK_MARGIN_DB       3
+#endif
+
+// Tyle kolejnych ech zdejmuje jeden krok kary za straty
+#ifndef MESH_LINK_RECOVER_SUCCESSES
+#define MESH_LINK_RECOVER_SUCCESSES 10
+#endif
+
+// Własne broadcasty czekające naraz na echo sąsiadów
+#ifndef MESH_LINK_PENDING
+#define MESH_LINK_PENDING         4
+#endif
+
+// Czas na echo: backoff forwardu / kolejka network coding z zapasem
+#ifndef MESH_LINK_ECHO_MS
+#define MESH_LINK_ECHO_MS         250
+#endif
+
+static_assert(MESH_LINK_MAX_NEIGHBORS <= 32, "MESH_LINK_MAX_NEIGHBORS must fit the 32-bit echo mask");
+
+// ================== TYPY ==================
+
+// Niezależne od ESP-IDF identyfikatory rate (od najwolniejszego)
+enum MeshPhyRate : uint8_t {
+  MESH_PHY_LR_250K = 0,
+  MESH_PHY_LR_500K,
+  MESH_PHY_1M,
+  MESH_PHY_2M,
+  MESH_PHY_5M5,
+  MESH_PHY_6M,
+  MESH_PHY_9M,
+  MESH_PHY_11M,
+  MESH_PHY_12M,
+  MESH_PHY_18M,
+  MESH_PHY_24M,
+  MESH_PHY_36M,
+  MESH_PHY_48M,
+  MESH_PHY_54M,
+  MESH_PHY_COUNT
+};
+
+struct mesh_link_config {
+  bool allow_lr;           // rate Long Range (tylko ESP32 <-> ESP32)
+  bool allow_ofdm;         // rate 11g (wymaga 11G po obu stronach)
+  bool adapt_power;        // obniżaj moc, gdy zapas jest duży przy max rate
+  int8_t max_power_q;      // maks. moc w 0.25 dBm (78 = 19.5 dBm)
+  int8_t min_power_q;      // dolna granica mocy
+  MeshPhyRate fallback;    // rate, gdy nie znamy żadnego sąsiada
+};
+
+struct mesh_link_choice {
+  MeshPhyRate rate;
+  uint16_t kbps;
+  int8_t power_q;
+};
+
+struct mesh_link_info {
+  uint8_t  mac[6];
+  int16_t  rssi;           // wygładzone RSSI (dBm)
+  uint8_t  penalty;        // kroki rate w dół za brakujące echa
+  uint16_t tx_ok;
+  uint16_t tx_fail;
+  uint32_t last_ms;
+};
+
+// ================== KLASA MeshLinkRate ==================
+
+// Czysta polityka wyboru rate/mocy dla broadcastu (mesh nie używa unicast):
+// RSSI per sąsiad (EWMA) + dostarczenia liczone z ech własnych wiadomości.
+// Sąsiad, który przekazał dalej naszą poprzednią wiadomość, powinien
+// przekazać i następną — brak echa w MESH_LINK_ECHO_MS to strata. Bez
+// wywołań ESP-IDF, czas podawany z zewnątrz.
+class MeshLinkRate {
+public:
+  MeshLinkRate();
+
+  void setConfig(const mesh_link_config &cfg) { _cfg = cfg; }
+  const mesh_link_config &config() const { return _cfg; }
+
+  // Próbka RSSI z odebranej ramki sąsiada
+  void onRssi(const uint8_t mac[6], int8_t rssi, uint32_t now_ms);
+  // Wynik dostarczenia do sąsiada (echo albo jego brak)
+  void onTxResult(const uint8_t mac[6], bool ok, uint32_t now_ms);
+
+  // Własny broadcast, który sąsiedzi powinni przekazać dalej (TTL > 1)
+  void onBroadcast(uint32_t mid, uint32_t now_ms);
+  // Sąsiad mac przekazał dalej naszą wiadomość mid
+  void onEcho(const uint8_t mac[6], uint32_t mid, uint32_t now_ms);
+  // mid to własny broadcast wciąż czekający na echa (np. w ramce XOR)
+  bool awaiting(uint32_t mid) const;
+  // Broadcasty bez echa po MESH_LINK_ECHO_MS → straty; wołane z loop()
+  void expire(uint32_t now_ms);
+
+  // Najszybszy rate osiągający najsłabszego świeżego sąsiada
+  mesh_link_choice selectBroadcast(uint32_t now_ms) const;
+
+  bool neighborAt(size_t i, mesh_link_info &out) const;
+  static size_t neighborCapacity() { return MESH_LINK_MAX_NEIGHBORS; }
+
+  static uint16_t rateKbps(MeshPhyRate rate);
+  static int8_t   rateMinRssi(MeshPhyRate rate);
+
+private:
+  struct Neighbor {
+    uint8_t  mac[6];
+    bool     used;
+    int16_t  rssi_x16;     // EWMA RSSI * 16
+    uint8_t  penalty;
+    uint8_t  ok_streak;
+    bool     echoes;       // przekazał dalej naszą ostatnią wiadomość
+    uint16_t tx_ok;
+    uint16_t tx_fail;
+    uint32_t last_ms;
+  };
+
+  struct Pending {
+    bool     used;
+    uint32_t mid;
+    uint32_t sent_ms;
+    uint32_t expect;       // bity _neighbors, od których czekamy na echo
+  };
+
+  Neighbor *_find(const uint8_t mac[6]);
+  const Neighbor *_find(const uint8_t mac[6]) const;
+  Neighbor *_findOrAdd(const uint8_t mac[6], uint32_t now_ms);
+  bool _allowed(MeshPhyRate rate) const;
+  mesh_link_choice _choose(int16_t rssi, uint8_t penalty) const;
+
+  mesh_link_config _cfg;
+  Neighbor _neighbors[MESH_LINK_MAX_NEIGHBORS];
+  Pending _pending[MESH_LINK_PENDING];
+};
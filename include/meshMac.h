@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// ================== MAC / HEX ==================
+
+// Wspólne pomocnicze dla komponentów i MeshLib (bez Arduino).
+
+// '0'-'9', 'a'-'f', 'A'-'F' -> 0..15; -1 dla innych znaków
+int meshHexValue(char c);
+
+// "AA:BB:CC:DD:EE:FF" (albo z '-') -> 6 bajtów; false przy złym formacie
+bool meshParseMac(const char *str, uint8_t out[6]);
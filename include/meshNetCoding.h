@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Długość zakodowanej części wiadomości: sender+type+topic+payload.
+// TTL i MID lecą jawnie w nagłówku, bo każda kopia ma inne TTL.
+#ifndef MESH_NC_BODY_LEN
+#define MESH_NC_BODY_LEN        238
+#endif
+
+// Pełne treści ostatnich wiadomości do dekodowania (po MESH_NC_BODY_LEN B).
+// Musi objąć ruch z ok. dwóch czasów MESH_NC_HOLD_MS — przy 8 wpisach
+// i ~200 wiadomościach/s część ramek XOR była już niedekodowalna (tools/meshnc)
+#ifndef MESH_NC_CACHE
+#define MESH_NC_CACHE           16
+#endif
+
+#ifndef MESH_NC_NEIGHBORS
+#define MESH_NC_NEIGHBORS       12
+#endif
+
+// MID-y zapamiętane jako "słyszane" per sąsiad. Do kodowania liczą się tylko
+// te z młodszej połowy cache (patrz canCombine), więc więcej nie ma sensu
+#ifndef MESH_NC_HEARD
+#define MESH_NC_HEARD           (MESH_NC_CACHE / 2)
+#endif
+
+#ifndef MESH_NC_NEIGHBOR_MS
+#define MESH_NC_NEIGHBOR_MS     30000
+#endif
+
+#define MESH_NC_MAGIC           0xC0
+
+// Długość ramki starego formatu (sizeof(standard_mesh_message)). Węzły
+// rozpoznają ją po samej długości, więc ramka XOR nigdy jej nie przyjmuje
+#define MESH_NC_LEGACY_LEN      244
+
+static_assert(MESH_NC_HEARD <= MESH_NC_CACHE,
+              "a neighbour can only decode MIDs still in its MESH_NC_CACHE");
+
+// ================== RAMKA ZAKODOWANA ==================
+
+struct mesh_coded_frame {
+  uint8_t  magic;      // MESH_NC_MAGIC
+  int8_t   ttl_a;
+  int8_t   ttl_b;
+  uint8_t  flags;      // do użytku warstwy wyżej (format oryginalnych ramek)
+  uint32_t mid_a;
+  uint32_t mid_b;
+  uint8_t  body[MESH_NC_BODY_LEN]; // body(a) XOR body(b), bez końcowych zer
+};
+
+// Długość na łączu: nagłówek + body do ostatniego niezerowego bajtu którejś
+// z wiadomości (reszta to zera w obu, odbiorca je dopisuje); długość
+// MESH_NC_LEGACY_LEN dostaje jeden bajt zera więcej
+#define MESH_NC_HEADER_LEN offsetof(mesh_coded_frame, body)
+#define MESH_NC_FRAME_LEN  (MESH_NC_HEADER_LEN + MESH_NC_BODY_LEN)
+
+static_assert(MESH_NC_FRAME_LEN <= 250, "coded frame exceeds ESP-NOW payload");
+
+struct mesh_nc_stats {
+  uint32_t coded_sent;    // ramki XOR (każda zastępuje dwie transmisje)
+  uint32_t plain_sent;
+  uint32_t decoded;
+  uint32_t undecodable;   // brak żadnej z dwóch wiadomości w cache
+};
+
+// ================== KLASA MeshNetCoder ==================
+
+// Czysty komponent w stylu COPE: śledzi, co słyszeli sąsiedzi, decyduje czy
+// dwie oczekujące wiadomości można wysłać jako jedną ramkę XOR i dekoduje
+// ramki z pomocą cache ostatnich treści. Bez Arduino, czas z zewnątrz.
+class MeshNetCoder {
+public:
+  MeshNetCoder();
+
+  // Sąsiad nb ma wiadomość mid (nadał ją, przekazał albo zakodował)
+  void onHeard(const uint8_t nb[6], uint32_t mid, uint32_t now_ms);
+
+  // Każdy świeży sąsiad ma a albo b (wciąż w jego cache treści), więc
+  // każdy zdekoduje brakującą
+  bool canCombine(uint32_t mid_a, uint32_t mid_b, uint32_t now_ms) const;
+
+  void remember(uint32_t mid, const uint8_t body[MESH_NC_BODY_LEN]);
+  const uint8_t *lookup(uint32_t mid) const;
+
+  // Zwraca długość ramki na łączu (≤ MESH_NC_FRAME_LEN)
+  static size_t encode(mesh_coded_frame &out,
+                       uint32_t mid_a, int8_t ttl_a, const uint8_t *body_a,
+                       uint32_t mid_b, int8_t ttl_b, const uint8_t *body_b);
+  // Odtwarza brakującą wiadomość z ramki o długości len; known_mid musi być w cache
+  bool decode(const mesh_coded_frame &in, size_t len, uint32_t known_mid,
+              uint8_t out_body[MESH_NC_BODY_LEN]) const;
+
+  mesh_nc_stats &stats() { return _stats; }
+  const mesh_nc_stats &stats() const { return _stats; }
+
+private:
+  struct Heard {
+    uint32_t mid;
+    uint32_t seq;          // _remembered w chwili usłyszenia
+  };
+
+  struct Neighbor {
+    uint8_t  mac[6];
+    bool     used;
+    uint8_t  heard_idx;
+    uint32_t last_ms;
+    Heard    heard[MESH_NC_HEARD];
+  };
+
+  struct CacheEntry {
+    uint32_t mid;
+    uint8_t  body[MESH_NC_BODY_LEN];
+  };
+
+  bool _hasHeard(const Neighbor &n, uint32_t mid) const;
+
+  Neighbor _neighbors[MESH_NC_NEIGHBORS];
+  CacheEntry _cache[MESH_NC_CACHE];
+  int _cache_idx = 0;
+  uint32_t _remembered = 0;   // licznik treści dodanych do cache
+  mesh_nc_stats _stats{};
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Limitowanie forwardów domyślnie wyłączone — włączenie zmienia zachowanie
+// istniejących sieci (porzucane forwardy), więc wymaga setRateLimitEnabled(true)
+#ifndef MESH_RATE_LIMIT
+#define MESH_RATE_LIMIT           0
+#endif
+
+// Liczba śledzonych nadawców (origin). Tablica jest stała: MESH_RL_WAYS-drożne
+// zbiory adresowane hashem MAC, więc lookup to zawsze O(MESH_RL_WAYS).
+#ifndef MESH_RL_ORIGINS
+#define MESH_RL_ORIGINS           32
+#endif
+
+#ifndef MESH_RL_WAYS
+#define MESH_RL_WAYS              4
+#endif
+
+// Limity per origin (wiadomości/s i burst) dla klasy CONTROL ("cmd")
+#ifndef MESH_RL_CONTROL_RATE
+#define MESH_RL_CONTROL_RATE      2
+#endif
+#ifndef MESH_RL_CONTROL_BURST
+#define MESH_RL_CONTROL_BURST     6
+#endif
+
+// Limity per origin dla klasy DATA ("data")
+#ifndef MESH_RL_DATA_RATE
+#define MESH_RL_DATA_RATE         5
+#endif
+#ifndef MESH_RL_DATA_BURST
+#define MESH_RL_DATA_BURST        10
+#endif
+
+// Globalny budżet airtime na forwardy: promile czasu radia i okno akumulacji
+#ifndef MESH_AIRTIME_BUDGET_PERMILLE
+#define MESH_AIRTIME_BUDGET_PERMILLE  100   // 10% airtime
+#endif
+#ifndef MESH_AIRTIME_WINDOW_MS
+#define MESH_AIRTIME_WINDOW_MS        1000
+#endif
+
+// Część budżetu (promile pojemności), której klasa DATA nie może zużyć —
+// zostaje dla komend, więc przy przeciążeniu najpierw odpada "data".
+#ifndef MESH_AIRTIME_DATA_RESERVE_PERMILLE
+#define MESH_AIRTIME_DATA_RESERVE_PERMILLE 250
+#endif
+
+// Bitrate używany do szacowania airtime (kbps); 11B 1 Mbps
+#ifndef MESH_AIRTIME_RATE_KBPS
+#define MESH_AIRTIME_RATE_KBPS    1000
+#endif
+
+// ================== TYPY ==================
+
+enum MeshPriority : uint8_t {
+  MESH_PRIO_CONTROL = 0,  // "cmd"
+  MESH_PRIO_DATA    = 1,  // "data" i pozostałe
+  MESH_PRIO_COUNT
+};
+
+enum MeshForwardVerdict : uint8_t {
+  MESH_FWD_OK = 0,
+  MESH_FWD_SHED_RATE,     // origin przekroczył swój token bucket
+  MESH_FWD_SHED_AIRTIME   // węzeł wyczerpał budżet airtime dla tej klasy
+};
+
+struct mesh_rate_limit {
+  uint16_t rate;   // wiadomości na sekundę (0 = bez limitu)
+  uint16_t burst;  // pojemność kubełka w wiadomościach
+};
+
+struct mesh_forward_stats {
+  uint32_t forwarded[MESH_PRIO_COUNT];
+  uint32_t shed_rate[MESH_PRIO_COUNT];
+  uint32_t shed_airtime[MESH_PRIO_COUNT];
+};
+
+struct mesh_origin_stats {
+  uint8_t  mac[6];
+  uint16_t shed[MESH_PRIO_COUNT];
+  uint32_t last_ms;
+};
+
+// ================== KLASA MeshRateLimiter ==================
+
+// Czysty komponent (bez Arduino/ESP-IDF): czas podawany z zewnątrz,
+// stała pamięć, O(1) na pakiet. Nie jest thread-safe — MeshLib woła go
+// tylko z kontekstu odbioru.
+class MeshRateLimiter {
+public:
+  MeshRateLimiter();
+
+  void setLimit(MeshPriority prio, uint16_t rate, uint16_t burst);
+  void setAirtimeBudget(uint16_t permille, uint16_t data_reserve_permille);
+  void setEnabled(bool enabled) { _enabled = enabled; }
+  bool enabled() const { return _enabled; }
+
+  // Decyzja dla jednego forwardu; przy MESH_FWD_OK zużywa token i airtime
+  MeshForwardVerdict admit(const uint8_t origin[6], MeshPriority prio,
+                           uint32_t airtime_us, uint32_t now_ms);
+
+  const mesh_forward_stats &stats() const { return _stats; }
+  // Kopiuje statystyki i-tego zajętego slotu; false gdy slot pusty
+  bool originAt(size_t i, mesh_origin_stats &out) const;
+  static size_t originCapacity() { return MESH_RL_ORIGINS; }
+  void resetStats();
+
+  // Szacowany czas nadawania ramki o długości len przy rate_kbps
+  static uint32_t airtimeUs(size_t len, uint32_t rate_kbps);
+
+private:
+  struct Origin {
+    uint8_t  mac[6];
+    bool     used;
+    uint32_t last_ms;
+    uint32_t tokens[MESH_PRIO_COUNT];  // mili-tokeny
+    uint16_t shed[MESH_PRIO_COUNT];
+  };
+
+  static_assert(MESH_RL_ORIGINS % MESH_RL_WAYS == 0, "MESH_RL_ORIGINS must be a multiple of MESH_RL_WAYS");
+
+  Origin *_lookup(const uint8_t mac[6], uint32_t now_ms);
+  void _refill(Origin &o, uint32_t now_ms) const;
+  void _refillAirtime(uint32_t now_ms);
+
+  bool _enabled = MESH_RATE_LIMIT;
+  mesh_rate_limit _limits[MESH_PRIO_COUNT];
+  Origin _origins[MESH_RL_ORIGINS];
+
+  uint16_t _airtime_permille = MESH_AIRTIME_BUDGET_PERMILLE;
+  uint16_t _data_reserve_permille = MESH_AIRTIME_DATA_RESERVE_PERMILLE;
+  uint32_t _airtime_us = 0;        // dostępny airtime (µs)
+  uint32_t _airtime_last_ms = 0;
+  bool _airtime_started = false;
+
+  mesh_forward_stats _stats{};
+};
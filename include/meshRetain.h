@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Twardy limit RAM na wartości retained (topic + payload + nagłówki wpisów)
+#ifndef MESH_RETAIN_POOL_BYTES
+#define MESH_RETAIN_POOL_BYTES  1024
+#endif
+
+#define MESH_RETAIN_TOPIC_MAX   64   // jak standard_mesh_message::topic
+#define MESH_RETAIN_PAYLOAD_MAX 140  // jak standard_mesh_message::payload
+
+// ================== TYPY ==================
+
+struct mesh_retained {
+  char    topic[MESH_RETAIN_TOPIC_MAX];
+  char    payload[MESH_RETAIN_PAYLOAD_MAX];
+  uint8_t publisher[6];
+};
+
+// ================== KLASA MeshRetainStore ==================
+
+// Ostatnia wartość per topic w jednej puli bajtów. Wpisy leżą w kolejności
+// aktualizacji, więc przy braku miejsca wypadają najdawniej zmienione.
+// Każdy zapis dostaje kolejny numer (seq): odtwarzanie idzie po seq, a nie
+// po indeksie, więc aktualizacja w trakcie (wpis przeskakuje na koniec) nie
+// gubi ani nie dubluje wpisów. Czysty komponent, bez alokacji na stercie.
+class MeshRetainStore {
+public:
+  MeshRetainStore() = default;
+
+  // Pusty payload usuwa topic (jak w MQTT)
+  bool put(const char *topic, const char *payload, const uint8_t publisher[6]);
+  bool remove(const char *topic);
+  bool find(const char *topic, mesh_retained &out) const;
+  bool contains(const char *topic) const { size_t off; return topic && _locate(topic, off); }
+  // i-ty wpis (od najstarszego); false gdy poza zakresem
+  bool at(size_t i, mesh_retained &out) const;
+  // najstarszy wpis zapisany po `after`; false gdy brak
+  bool next(uint32_t after, mesh_retained &out, uint32_t &seq) const;
+  // seq ostatniego zapisu; wpisy mają seq w (firstSeq() - 1, lastSeq()]
+  uint32_t lastSeq() const { return _seq; }
+  uint32_t firstSeq() const { return _used ? _seqAt(0) : _seq + 1; }
+
+  size_t count() const { return _count; }
+  size_t usedBytes() const { return _used; }
+  static size_t capacity() { return MESH_RETAIN_POOL_BYTES; }
+  void clear() { _used = 0; _count = 0; }
+
+private:
+  // [topic_len][payload_len][publisher 6B][seq 4B][topic][payload]
+  static const size_t HDR = 12;
+
+  size_t _entryLen(size_t off) const { return HDR + _pool[off] + _pool[off + 1]; }
+  uint32_t _seqAt(size_t off) const {
+    uint32_t seq;
+    memcpy(&seq, &_pool[off + 8], sizeof(seq));
+    return seq;
+  }
+  bool _locate(const char *topic, size_t &off) const;
+  void _erase(size_t off);
+  void _read(size_t off, mesh_retained &out) const;
+
+  uint8_t _pool[MESH_RETAIN_POOL_BYTES];
+  size_t _used = 0;
+  size_t _count = 0;
+  uint32_t _seq = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== KONFIGURACJA / DOMYŚLNE ==================
+
+// Rozmiar filtra Blooma jednego poziomu (bajty) i liczba funkcji hash
+#ifndef MESH_SF_BYTES
+#define MESH_SF_BYTES           16
+#endif
+
+#ifndef MESH_SF_HASHES
+#define MESH_SF_HASHES          3
+#endif
+
+// Poziom d = subskrypcje węzłów d hopów za sąsiadem; powinno pokrywać TTL
+#ifndef MESH_SF_LEVELS
+#define MESH_SF_LEVELS          4
+#endif
+
+#ifndef MESH_SF_NEIGHBORS
+#define MESH_SF_NEIGHBORS       12
+#endif
+
+// Okres ogłoszeń i czas, po którym filtr sąsiada traktujemy jako nieznany
+#ifndef MESH_SF_ADVERT_MS
+#define MESH_SF_ADVERT_MS       10000
+#endif
+
+#ifndef MESH_SF_EXPIRE_MS
+#define MESH_SF_EXPIRE_MS       35000
+#endif
+
+#define MESH_SF_MAGIC           0xC2
+
+// ================== RAMKA OGŁOSZENIA ==================
+
+// Wysyłana tylko do sąsiadów (bez forwardu, bez dedup)
+struct mesh_sub_advert {
+  uint8_t magic;    // MESH_SF_MAGIC
+  uint8_t levels;   // MESH_SF_LEVELS nadawcy
+  uint8_t bytes;    // MESH_SF_BYTES nadawcy; inne = ramka ignorowana
+  uint8_t filter[MESH_SF_LEVELS][MESH_SF_BYTES];
+};
+
+#define MESH_SF_ADVERT_LEN  (offsetof(mesh_sub_advert, filter) + MESH_SF_LEVELS * MESH_SF_BYTES)
+
+static_assert(MESH_SF_ADVERT_LEN <= 250, "subscription advert exceeds ESP-NOW payload");
+
+struct mesh_sf_stats {
+  uint32_t adverts_sent;
+  uint32_t adverts_heard;
+  uint32_t forwarded;     // forward dozwolony przez filtry
+  uint32_t fallback;      // forward, bo sąsiad bez (świeżego) filtra lub TTL > poziomów
+  uint32_t pruned;        // nikt za nami nie subskrybuje
+};
+
+// ================== KLASA MeshSubFilter ==================
+
+// Przycinanie floodu według subskrypcji (tłumione filtry Blooma): węzeł
+// ogłasza sąsiadom filtr własnych subskrypcji (poziom 0) i sumy filtrów
+// sąsiadów o poziom niżej (poziom d = węzły d hopów dalej). Relay przekazuje
+// wiadomość z TTL t tylko gdy któryś sąsiad ma jej topic na poziomach < t.
+// Sąsiad słyszany, ale bez świeżego filtra = pełny flood. Głębsze poziomy
+// sąsiada są pełne dopiero po kilku rundach ogłoszeń, więc do MESH_SF_LEVELS
+// ogłoszeń od niego też pełny flood. Czysty komponent, czas z zewnątrz.
+class MeshSubFilter {
+public:
+  MeshSubFilter();
+
+  // Własne subskrypcje; wantAll = brak filtra (odbieraj wszystko)
+  void clearLocal();
+  void addLocal(uint16_t topic_id);
+  void setWantAll(bool want_all);
+
+  // Dowolna ramka od sąsiada (utrzymuje go jako "świeżego")
+  void onHeard(const uint8_t nb[6], uint32_t now_ms);
+  bool onAdvert(const uint8_t nb[6], const uint8_t *data, size_t len, uint32_t now_ms);
+
+  // Buduje ogłoszenie z aktualnych filtrów; true gdy różni się od poprzedniego
+  bool buildAdvert(mesh_sub_advert &out, uint32_t now_ms);
+
+  // ttl_left = TTL po zmniejszeniu, z jakim wiadomość poszłaby dalej
+  bool shouldForward(uint16_t topic_id, int ttl_left, uint32_t now_ms);
+
+  mesh_sf_stats &stats() { return _stats; }
+  const mesh_sf_stats &stats() const { return _stats; }
+
+  static void bloomAdd(uint8_t bits[MESH_SF_BYTES], uint16_t topic_id);
+  static bool bloomTest(const uint8_t bits[MESH_SF_BYTES], uint16_t topic_id);
+
+private:
+  struct Neighbor {
+    uint8_t  mac[6];
+    bool     used;
+    bool     has_filter;
+    uint32_t last_ms;     // ostatnia dowolna ramka
+    uint32_t filter_ms;   // ostatnie ogłoszenie
+    uint8_t  adverts;     // kolejne świeże ogłoszenia (do MESH_SF_LEVELS)
+    uint8_t  filter[MESH_SF_LEVELS][MESH_SF_BYTES];
+  };
+
+  Neighbor *_neighbor(const uint8_t nb[6], uint32_t now_ms);
+  static bool _fresh(uint32_t since_ms, uint32_t now_ms) {
+    return uint32_t(now_ms - since_ms) <= MESH_SF_EXPIRE_MS;
+  }
+
+  Neighbor _neighbors[MESH_SF_NEIGHBORS];
+  uint8_t _local[MESH_SF_BYTES];
+  uint8_t _last_advert[MESH_SF_LEVELS][MESH_SF_BYTES];
+  mesh_sf_stats _stats{};
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// ================== ID TOPICÓW ==================
+
+// 16-bitowe ID topicu liczone w czasie kompilacji (FNV-1a 32 zwinięte do 16
+// bitów). 0 jest zarezerwowane jako "brak ID". Styl C++11 — jedno return.
+
+constexpr uint32_t meshFnv1a(const char *s, uint32_t h = 2166136261u) {
+  return *s ? meshFnv1a(s + 1, (h ^ uint8_t(*s)) * 16777619u) : h;
+}
+
+constexpr uint16_t meshFoldId(uint32_t h) {
+  return uint16_t((h >> 16) ^ (h & 0xFFFFu)) ? uint16_t((h >> 16) ^ (h & 0xFFFFu)) : uint16_t(1);
+}
+
+constexpr uint16_t meshTopicId(const char *topic) {
+  return meshFoldId(meshFnv1a(topic));
+}
+
+// Sprawdzenie kolizji listy ID w czasie kompilacji:
+//   static_assert(meshTopicIdsUnique(MESH_TOPIC_ID("a"), MESH_TOPIC_ID("b")), "kolizja");
+constexpr bool meshTopicIdNotIn(uint16_t) { return true; }
+
+template <typename... Rest>
+constexpr bool meshTopicIdNotIn(uint16_t id, uint16_t first, Rest... rest) {
+  return id != first && meshTopicIdNotIn(id, rest...);
+}
+
+constexpr bool meshTopicIdsUnique() { return true; }
+
+template <typename... Rest>
+constexpr bool meshTopicIdsUnique(uint16_t first, Rest... rest) {
+  return meshTopicIdNotIn(first, rest...) && meshTopicIdsUnique(rest...);
+}
+
+#define MESH_TOPIC_ID(literal)  (meshTopicId(literal))
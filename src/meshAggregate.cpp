@@ -0,0 +1,132 @@
+#include "meshAggregate.h"
+#include <string.h>
+
+// ================== KONSTRUKTOR ==================
+
+MeshAggregator::MeshAggregator() {
+  memset(_sessions, 0, sizeof(_sessions));
+}
+
+// ================== WARTOŚCI ==================
+
+void MeshAggregator::clear(mesh_agg_value &v) {
+  v.count = 0;
+  v.min = INT32_MAX;
+  v.max = INT32_MIN;
+  v.sum = 0;
+}
+
+void MeshAggregator::add(mesh_agg_value &v, int32_t x) {
+  v.count++;
+  if (x < v.min) v.min = x;
+  if (x > v.max) v.max = x;
+  v.sum += x;
+}
+
+void MeshAggregator::merge(mesh_agg_value &into, const mesh_agg_value &other) {
+  if (other.count == 0) return;
+  into.count += other.count;
+  if (other.min < into.min) into.min = other.min;
+  if (other.max > into.max) into.max = other.max;
+  into.sum += other.sum;
+}
+
+// ================== SESJE ==================
+
+MeshAggregator::Session *MeshAggregator::_alloc(uint32_t qid) {
+  if (qid == 0 || active(qid)) return nullptr;
+  for (size_t i = 0; i < MESH_AGG_SESSIONS; ++i) {
+    if (!_sessions[i].used) return &_sessions[i];
+  }
+  return nullptr;
+}
+
+bool MeshAggregator::active(uint32_t qid) const {
+  for (size_t i = 0; i < MESH_AGG_SESSIONS; ++i) {
+    if (_sessions[i].used && _sessions[i].qid == qid) return true;
+  }
+  return false;
+}
+
+bool MeshAggregator::start(uint32_t qid, const char *name, uint8_t max_depth, uint16_t slot_ms,
+                           uint32_t now_ms) {
+  Session *s = _alloc(qid);
+  if (!s) return false;
+  memset(s, 0, sizeof(*s));
+  s->used = true;
+  s->origin = true;
+  s->qid = qid;
+  strncpy(s->name, name, sizeof(s->name) - 1);
+  // dzieci na głębokości 1 odpowiadają do (D-1) okien + pół okna rozrzutu
+  s->deadline_ms = now_ms + uint32_t(max_depth) * slot_ms;
+  clear(s->value);
+  _stats.queries++;
+  return true;
+}
+
+bool MeshAggregator::onQuery(uint32_t qid, const char *name, const uint8_t parent[6],
+                             uint8_t depth, uint8_t max_depth, uint16_t slot_ms,
+                             uint32_t now_ms, uint32_t jitter_ms) {
+  if (depth == 0 || depth > max_depth) return false;
+  Session *s = _alloc(qid);
+  if (!s) return false;
+  memset(s, 0, sizeof(*s));
+  s->used = true;
+  s->qid = qid;
+  memcpy(s->parent, parent, 6);
+  strncpy(s->name, name, sizeof(s->name) - 1);
+  // liście (d = D) odpowiadają od razu, każdy poziom wyżej o okno później
+  s->deadline_ms = now_ms + uint32_t(max_depth - depth) * slot_ms + jitter_ms;
+  clear(s->value);
+  _stats.queries++;
+  return true;
+}
+
+bool MeshAggregator::onReply(uint32_t qid, const mesh_agg_value &v, uint32_t now_ms) {
+  for (size_t i = 0; i < MESH_AGG_SESSIONS; ++i) {
+    Session &s = _sessions[i];
+    if (!s.used || s.qid != qid) continue;
+    if (int32_t(now_ms - s.deadline_ms) >= 0) break; // już odpowiedzieliśmy / zaraz
+    merge(s.value, v);
+    _stats.replies_merged++;
+    return true;
+  }
+  _stats.replies_late++;
+  return false;
+}
+
+bool MeshAggregator::due(uint32_t now_ms, bool &origin, uint8_t parent[6], mesh_agg_result &result) {
+  for (size_t i = 0; i < MESH_AGG_SESSIONS; ++i) {
+    Session &s = _sessions[i];
+    if (!s.used || int32_t(now_ms - s.deadline_ms) < 0) continue;
+
+    origin = s.origin;
+    memcpy(parent, s.parent, 6);
+    result.qid = s.qid;
+    memcpy(result.name, s.name, sizeof(result.name));
+    result.value = s.value;
+    s.used = false;
+    return true;
+  }
+  return false;
+}
+
+// ================== RAMKA ODPOWIEDZI ==================
+
+void MeshAggregator::toReply(const mesh_agg_result &r, const uint8_t parent[6], mesh_agg_reply &out) {
+  memset(&out, 0, sizeof(out));
+  out.magic = MESH_AGG_MAGIC;
+  memcpy(out.parent, parent, 6);
+  out.qid   = r.qid;
+  out.count = r.value.count;
+  out.min   = r.value.min;
+  out.max   = r.value.max;
+  out.sum   = r.value.sum;
+}
+
+void MeshAggregator::fromReply(const mesh_agg_reply &in, mesh_agg_value &out) {
+  out.count = in.count;
+  out.min   = in.min;
+  out.max   = in.max;
+  out.sum   = in.sum;
+}
@@ -0,0 +1,257 @@
+#include "meshBackbone.h"
+#include <string.h>
+
+// ================== KONSTRUKTOR ==================
+
+MeshBackbone::MeshBackbone() {
+  memset(_self, 0, sizeof(_self));
+  memset(_neighbors, 0, sizeof(_neighbors));
+  memset(_work, 0, sizeof(_work));
+  memset(_n2_id, 0xFF, sizeof(_n2_id));
+  memset(_covered, 0, sizeof(_covered));
+  memset(_leaf, 0, sizeof(_leaf));
+}
+
+void MeshBackbone::setSelf(const uint8_t mac[6]) {
+  memcpy(_self, mac, 6);
+}
+
+int MeshBackbone::_findIn(const Neighbor *table, const uint8_t mac[6]) {
+  for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+    if (table[i].used && memcmp(table[i].mac, mac, 6) == 0) return int(i);
+  }
+  return -1;
+}
+
+// ================== HELLO ==================
+
+bool MeshBackbone::onHello(const uint8_t nb[6], const uint8_t *data, size_t len,
+                           uint32_t now_ms, bool *new_neighbor) {
+  if (len < offsetof(mesh_hello, entries) || data[0] != MESH_BB_MAGIC) return false;
+  const size_t count = data[2];
+  if (len != MESH_BB_HELLO_LEN(count)) return false;
+
+  int idx = _find(nb);
+  const bool fresh_entry = (idx < 0 || !_fresh(_neighbors[idx], now_ms));
+  if (idx < 0) {
+    // wolny slot, inaczej najdawniej słyszany sąsiad
+    Neighbor *victim = &_neighbors[0];
+    for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+      Neighbor &c = _neighbors[i];
+      if (!victim->used) break;
+      if (!c.used || int32_t(c.last_ms - victim->last_ms) < 0) victim = &c;
+    }
+    idx = int(victim - _neighbors);
+  }
+
+  Neighbor &n = _neighbors[idx];
+  memset(&n, 0, sizeof(n));
+  memcpy(n.mac, nb, 6);
+  n.used = true;
+  n.last_ms = now_ms;
+  n.truncated = (data[1] & MESH_BB_TRUNCATED) != 0;
+
+  const uint8_t *e = data + offsetof(mesh_hello, entries);
+  for (size_t i = 0; i < count; ++i, e += sizeof(mesh_hello_entry)) {
+    const uint8_t flags = e[6];
+    if (flags & MESH_BB_SYM) n.any_sym = true;
+    if (memcmp(e, _self, 6) == 0) {
+      n.sym = true;
+      n.selected_us = (flags & MESH_BB_MPR) != 0;
+    } else if ((flags & MESH_BB_SYM) && n.two_hop_count < MESH_BB_NEIGHBORS) {
+      memcpy(n.two_hop[n.two_hop_count++], e, 6);
+    }
+  }
+
+  _stats.hellos_heard++;
+  if (new_neighbor) *new_neighbor = fresh_entry;
+  return true;
+}
+
+size_t MeshBackbone::buildHello(mesh_hello &out, uint32_t now_ms) {
+  beginSelect();
+  select(now_ms);
+  return finishHello(out, now_ms);
+}
+
+void MeshBackbone::beginSelect() {
+  memcpy(_work, _neighbors, sizeof(_work));
+}
+
+void MeshBackbone::select(uint32_t now_ms) {
+  _selectMprs(_work, now_ms);
+}
+
+size_t MeshBackbone::finishHello(mesh_hello &out, uint32_t now_ms) {
+  // po MAC-u: callback mógł w międzyczasie przenieść sąsiada do innego slotu
+  for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+    Neighbor &n = _neighbors[i];
+    if (!n.used) continue;
+    const int w = _findIn(_work, n.mac);
+    n.mpr = (w >= 0 && _work[w].mpr);
+  }
+
+  out.magic = MESH_BB_MAGIC;
+  out.flags = 0;
+  size_t count = 0;
+  for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+    const Neighbor &n = _neighbors[i];
+    if (!_fresh(n, now_ms)) continue;
+    memcpy(out.entries[count].mac, n.mac, 6);
+    out.entries[count].flags = uint8_t((n.sym ? MESH_BB_SYM : 0) | (n.mpr ? MESH_BB_MPR : 0));
+    ++count;
+  }
+  // pełna tablica = mogliśmy wyrzucić kogoś, kto nas słyszy
+  if (count == MESH_BB_NEIGHBORS) out.flags |= MESH_BB_TRUNCATED;
+  out.count = uint8_t(count);
+  return MESH_BB_HELLO_LEN(count);
+}
+
+// ================== WYBÓR MPR ==================
+
+void MeshBackbone::_selectMprs(Neighbor *table, uint32_t now_ms) {
+  const size_t NB = MESH_BB_NEIGHBORS;
+  for (size_t i = 0; i < NB; ++i) table[i].mpr = false;
+  memset(_n2_id, 0xFF, sizeof(_n2_id));
+  memset(_covered, 0, sizeof(_covered));
+
+  // N2: symetryczni sąsiedzi sąsiadów, bez nas i bez naszych sąsiadów.
+  // ID = indeks pierwszego wystąpienia MAC-a, żeby liczyć węzły, nie wpisy.
+  for (size_t i = 0; i < NB; ++i) {
+    const Neighbor &n = table[i];
+    if (!_fresh(n, now_ms) || !n.sym) continue;
+    for (size_t k = 0; k < n.two_hop_count; ++k) {
+      const uint8_t *y = n.two_hop[k];
+      if (memcmp(y, _self, 6) == 0) continue;
+      const int j = _findIn(table, y);
+      if (j >= 0 && _fresh(table[j], now_ms) && table[j].sym) continue;
+
+      uint16_t id = uint16_t(i * NB + k);
+      for (size_t pi = 0; pi <= i && id == uint16_t(i * NB + k); ++pi) {
+        const size_t kend = (pi == i) ? k : table[pi].two_hop_count;
+        for (size_t pk = 0; pk < kend; ++pk) {
+          if (_n2_id[pi][pk] != NONE && memcmp(table[pi].two_hop[pk], y, 6) == 0) {
+            id = _n2_id[pi][pk];
+            break;
+          }
+        }
+      }
+      _n2_id[i][k] = id;
+    }
+  }
+
+  // 1) jedyny sąsiad prowadzący do danego węzła N2 musi być MPR-em
+  for (size_t i = 0; i < NB; ++i) {
+    for (size_t k = 0; k < NB; ++k) {
+      const uint16_t u = _n2_id[i][k];
+      if (u != uint16_t(i * NB + k)) continue; // brak lub nie pierwsze wystąpienie
+      int provider = -1;
+      int providers = 0;
+      for (size_t i2 = 0; i2 < NB && providers < 2; ++i2) {
+        for (size_t k2 = 0; k2 < NB; ++k2) {
+          if (_n2_id[i2][k2] == u) { provider = int(i2); ++providers; break; }
+        }
+      }
+      if (providers == 1) table[provider].mpr = true;
+    }
+  }
+
+  for (size_t i = 0; i < NB; ++i) {
+    if (!table[i].mpr) continue;
+    for (size_t k = 0; k < NB; ++k) {
+      const uint16_t u = _n2_id[i][k];
+      if (u != NONE) _covered[u >> 3] |= uint8_t(1u << (u & 7));
+    }
+  }
+
+  // 2) zachłannie: sąsiad pokrywający najwięcej niepokrytych (remis: mniejszy MAC)
+  while (true) {
+    int best = -1;
+    int best_gain = 0;
+    for (size_t i = 0; i < NB; ++i) {
+      const Neighbor &n = table[i];
+      if (n.mpr || !_fresh(n, now_ms) || !n.sym) continue;
+      int gain = 0;
+      for (size_t k = 0; k < n.two_hop_count; ++k) {
+        const uint16_t u = _n2_id[i][k];
+        if (u != NONE && !(_covered[u >> 3] & (1u << (u & 7)))) ++gain;
+      }
+      if (gain > best_gain ||
+          (gain == best_gain && gain > 0 && memcmp(n.mac, table[best].mac, 6) < 0)) {
+        best = int(i);
+        best_gain = gain;
+      }
+    }
+    if (best < 0) break;
+
+    table[best].mpr = true;
+    for (size_t k = 0; k < NB; ++k) {
+      const uint16_t u = _n2_id[best][k];
+      if (u != NONE) _covered[u >> 3] |= uint8_t(1u << (u & 7));
+    }
+  }
+}
+
+// ================== DECYZJA O FORWARDZIE ==================
+
+bool MeshBackbone::shouldRelay(const uint8_t tx[6], uint32_t mid, uint32_t now_ms) {
+  const int i = _find(tx);
+  if (i < 0 || !_fresh(_neighbors[i], now_ms)) {
+    _stats.fallback++; // nadawca bez hello — pełny flood
+    return true;
+  }
+  const Neighbor &n = _neighbors[i];
+  if (n.selected_us) {
+    _stats.relayed++;
+    return true;
+  }
+  // nadawca jeszcze nie zbiegł się albo mógł nas nie zmieścić w tablicy
+  if (!n.any_sym || (n.truncated && !n.sym)) {
+    _stats.fallback++;
+    return true;
+  }
+  _stats.suppressed++;
+  _leaf[_leaf_next].used = true;
+  _leaf[_leaf_next].mid = mid;
+  _leaf_next = uint8_t((_leaf_next + 1) % MESH_BB_PENDING);
+  return false;
+}
+
+bool MeshBackbone::relayDuplicate(const uint8_t tx[6], uint32_t mid, uint32_t now_ms) {
+  for (size_t i = 0; i < MESH_BB_PENDING; ++i) {
+    LeafMid &l = _leaf[i];
+    if (!l.used || l.mid != mid) continue;
+    const int n = _find(tx);
+    if (n < 0 || !_fresh(_neighbors[n], now_ms) || !_neighbors[n].selected_us) return false;
+    l.used = false;
+    _stats.late++;
+    return true;
+  }
+  return false;
+}
+
+// ================== DIAGNOSTYKA ==================
+
+size_t MeshBackbone::neighborCount(uint32_t now_ms) const {
+  size_t c = 0;
+  for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+    if (_fresh(_neighbors[i], now_ms)) ++c;
+  }
+  return c;
+}
+
+size_t MeshBackbone::mprCount() const {
+  size_t c = 0;
+  for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+    if (_neighbors[i].used && _neighbors[i].mpr) ++c;
+  }
+  return c;
+}
+
+size_t MeshBackbone::selectorCount(uint32_t now_ms) const {
+  size_t c = 0;
+  for (size_t i = 0; i < MESH_BB_NEIGHBORS; ++i) {
+    if (_fresh(_neighbors[i], now_ms) && _neighbors[i].selected_us) ++c;
+  }
+  return c;
+}
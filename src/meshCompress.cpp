@@ -0,0 +1,144 @@
+#include "meshCompress.h"
+#include <string.h>
+
+#if defined(ARDUINO_ARCH_ESP8266)
+  #include <pgmspace.h>     // słownik we flashu, nie w RAM
+#else
+  #ifndef PROGMEM
+    #define PROGMEM
+  #endif
+  #ifndef pgm_read_byte
+    #define pgm_read_byte(p) (*(const uint8_t*)(p))
+  #endif
+  #ifndef pgm_read_word
+    #define pgm_read_word(p) (*(const uint16_t*)(p))
+  #endif
+#endif
+
+#include "meshCompressDict.h"
+
+static const size_t DICT_LEN = sizeof(MESH_LZ_DICT) - 1;   // bez końcowego '\0'
+
+static_assert(sizeof(MESH_LZ_DICT) - 1 + 255 <= MESH_LZ_MAX_DIST,
+              "preset dictionary too long for the match distance field");
+static_assert(sizeof(MESH_LZ_DICT_PREV) / sizeof(uint16_t) == sizeof(MESH_LZ_DICT) - 1,
+              "dictionary index out of date, regenerate with tools/meshdict");
+
+static const uint16_t CHAIN_END = 0xFFFF;
+
+// Bajt okna: pozycje [0, DICT_LEN) to słownik, dalej dane
+static inline uint8_t windowByte(const uint8_t *data, size_t pos) {
+  return pos < DICT_LEN ? uint8_t(pgm_read_byte(&MESH_LZ_DICT[pos])) : data[pos - DICT_LEN];
+}
+
+size_t MeshLz::dictSize() {
+  return DICT_LEN;
+}
+
+// ================== KOMPRESJA ==================
+
+static bool emitLiterals(const uint8_t *in, size_t from, size_t to,
+                         uint8_t *out, size_t out_cap, size_t &op) {
+  while (from < to) {
+    size_t n = to - from;
+    if (n > MESH_LZ_MAX_LITERALS) n = MESH_LZ_MAX_LITERALS;
+    if (op + 1 + n > out_cap) return false;
+    out[op++] = uint8_t(n - 1);
+    memcpy(out + op, in + from, n);
+    op += n;
+    from += n;
+  }
+  return true;
+}
+
+// Długość dopasowania od pozycji okna c (pierwszy bajt już zgodny)
+static inline size_t matchLen(const uint8_t *in, size_t c, size_t i, size_t limit) {
+  size_t n = 1;
+  while (n < limit && windowByte(in, c + n) == in[i + n]) ++n;
+  return n;
+}
+
+size_t MeshLz::compress(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap) {
+  if (!in || !out || len == 0) return 0;
+
+  size_t op = 0;
+  size_t lit_start = 0;
+  size_t i = 0;
+  while (i < len) {
+    // najdłuższe dopasowanie w oknie [słownik][in[0..i)], zachłannie, od najbliższych
+    const size_t here = DICT_LEN + i;
+    size_t limit = len - i;
+    if (limit > MESH_LZ_MAX_MATCH) limit = MESH_LZ_MAX_MATCH;
+
+    size_t best_len = 0;
+    size_t best_dist = 0;
+    if (limit >= MESH_LZ_MIN_MATCH) {
+      for (size_t c = i; c-- > 0 && best_len < limit;) {
+        if (in[c] != in[i]) continue;
+        const size_t n = matchLen(in, DICT_LEN + c, i, limit);
+        if (n > best_len) {
+          best_len = n;
+          best_dist = i - c;
+        }
+      }
+      // w słowniku tylko pozycje zaczynające się od in[i] (indeks we flashu)
+      for (uint16_t c = pgm_read_word(&MESH_LZ_DICT_HEAD[in[i]]);
+           c != CHAIN_END && best_len < limit && here - c <= MESH_LZ_MAX_DIST;
+           c = pgm_read_word(&MESH_LZ_DICT_PREV[c])) {
+        const size_t n = matchLen(in, c, i, limit);
+        if (n > best_len) {
+          best_len = n;
+          best_dist = here - c;
+        }
+      }
+    }
+
+    if (best_len < MESH_LZ_MIN_MATCH) {
+      ++i;
+      continue;
+    }
+
+    if (!emitLiterals(in, lit_start, i, out, out_cap, op)) return 0;
+    if (op + 2 > out_cap) return 0;
+    const size_t d = best_dist - 1;
+    out[op++] = uint8_t(0x80 | ((best_len - MESH_LZ_MIN_MATCH) << 3) | (d >> 8));
+    out[op++] = uint8_t(d & 0xFF);
+    i += best_len;
+    lit_start = i;
+  }
+  if (!emitLiterals(in, lit_start, len, out, out_cap, op)) return 0;
+  return op;
+}
+
+// ================== DEKOMPRESJA ==================
+
+bool MeshLz::decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap,
+                        size_t &out_len) {
+  out_len = 0;
+  if (!in || !out) return false;
+
+  size_t ip = 0;
+  size_t op = 0;
+  while (ip < len) {
+    const uint8_t t = in[ip++];
+    if (!(t & 0x80)) {
+      const size_t n = size_t(t) + 1;
+      if (ip + n > len || op + n > out_cap) return false;
+      memcpy(out + op, in + ip, n);
+      ip += n;
+      op += n;
+      continue;
+    }
+
+    if (ip >= len) return false;
+    const size_t n = size_t((t >> 3) & 0x0F) + MESH_LZ_MIN_MATCH;
+    const size_t dist = ((size_t(t & 0x07) << 8) | in[ip++]) + 1;
+    if (dist > DICT_LEN + op || op + n > out_cap) return false;
+    // bajt po bajcie: kopia może nachodzić na właśnie pisane dane
+    for (size_t k = 0; k < n; ++k, ++op) {
+      out[op] = windowByte(out, DICT_LEN + op - dist);
+    }
+  }
+  out_len = op;
+  return true;
+}
@@ -0,0 +1,293 @@
+#include "meshDelta.h"
+#include <string.h>
+
+// ================== SHA-256 ==================
+
+static const uint32_t SHA_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void MeshSha256::reset() {
+  static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  memcpy(_h, H0, sizeof(_h));
+  _len = 0;
+  _fill = 0;
+}
+
+void MeshSha256::_block(const uint8_t *p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) {
+    w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) |
+           (uint32_t(p[4 * i + 2]) << 8) | uint32_t(p[4 * i + 3]);
+  }
+  for (int i = 16; i < 64; ++i) {
+    const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3];
+  uint32_t e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+  for (int i = 0; i < 64; ++i) {
+    const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA_K[i] + w[i];
+    const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d;
+  _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+}
+
+void MeshSha256::update(const uint8_t *data, size_t len) {
+  _len += len;
+  while (len > 0) {
+    const size_t n = (64 - _fill < len) ? 64 - _fill : len;
+    memcpy(_buf + _fill, data, n);
+    _fill += n;
+    data += n;
+    len -= n;
+    if (_fill == 64) {
+      _block(_buf);
+      _fill = 0;
+    }
+  }
+}
+
+void MeshSha256::finish(uint8_t out[MESH_DELTA_HASH_LEN]) {
+  const uint64_t bits = _len * 8;
+  const uint8_t pad = 0x80;
+  update(&pad, 1);
+  const uint8_t zero = 0;
+  while (_fill != 56) update(&zero, 1);
+  uint8_t be[8];
+  for (int i = 0; i < 8; ++i) be[i] = uint8_t(bits >> (56 - 8 * i));
+  update(be, 8);
+  for (int i = 0; i < 8; ++i) {
+    out[4 * i]     = uint8_t(_h[i] >> 24);
+    out[4 * i + 1] = uint8_t(_h[i] >> 16);
+    out[4 * i + 2] = uint8_t(_h[i] >> 8);
+    out[4 * i + 3] = uint8_t(_h[i]);
+  }
+}
+
+// ================== NAGŁÓWEK ==================
+
+static uint32_t readLe32(const uint8_t *p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static void writeLe32(uint8_t *p, uint32_t v) {
+  p[0] = uint8_t(v);
+  p[1] = uint8_t(v >> 8);
+  p[2] = uint8_t(v >> 16);
+  p[3] = uint8_t(v >> 24);
+}
+
+bool MeshDeltaApplier::parseHeader(const uint8_t raw[MESH_DELTA_HEADER_LEN], mesh_delta_header &out) {
+  if (memcmp(raw, MESH_DELTA_MAGIC, 4) != 0) return false;
+  out.old_size = readLe32(raw + 4);
+  out.new_size = readLe32(raw + 8);
+  memcpy(out.old_hash, raw + 12, MESH_DELTA_HASH_LEN);
+  memcpy(out.new_hash, raw + 12 + MESH_DELTA_HASH_LEN, MESH_DELTA_HASH_LEN);
+  return true;
+}
+
+void MeshDeltaApplier::writeHeader(const mesh_delta_header &hdr, uint8_t raw[MESH_DELTA_HEADER_LEN]) {
+  memcpy(raw, MESH_DELTA_MAGIC, 4);
+  writeLe32(raw + 4, hdr.old_size);
+  writeLe32(raw + 8, hdr.new_size);
+  memcpy(raw + 12, hdr.old_hash, MESH_DELTA_HASH_LEN);
+  memcpy(raw + 12 + MESH_DELTA_HASH_LEN, hdr.new_hash, MESH_DELTA_HASH_LEN);
+}
+
+const char *MeshDeltaApplier::resultName(MeshDeltaResult r) {
+  switch (r) {
+    case MESH_DELTA_MORE:       return "more";
+    case MESH_DELTA_OK:         return "ok";
+    case MESH_DELTA_ERR_FORMAT: return "format";
+    case MESH_DELTA_ERR_BASE:   return "base";
+    case MESH_DELTA_ERR_READ:   return "read";
+    case MESH_DELTA_ERR_WRITE:  return "write";
+    case MESH_DELTA_ERR_HASH:   return "hash";
+  }
+  return "?";
+}
+
+// ================== NAKŁADANIE ŁATKI ==================
+
+void MeshDeltaApplier::begin(MeshDeltaSource &src, MeshDeltaSink &dst) {
+  _src = &src;
+  _dst = &dst;
+  _phase = HEADER;
+  _result = MESH_DELTA_MORE;
+  _hdr = mesh_delta_header{};
+  _raw_fill = 0;
+  _varint = 0;
+  _varint_shift = 0;
+  _op_len = 0;
+  _copy_pos = 0;
+  _base_pos = 0;
+  _written = 0;
+  _sha.reset();
+}
+
+size_t MeshDeltaApplier::wants() const {
+  switch (_phase) {
+    case HEADER:   return MESH_DELTA_HEADER_LEN - _raw_fill;
+    case OP:
+    case COPY_OFF: return 1; // varinty bajt po bajcie: kopia może wymagać poll()
+    case LITERAL:  return _op_len;
+    default:       return 0;
+  }
+}
+
+MeshDeltaResult MeshDeltaApplier::_fail(MeshDeltaResult r) {
+  // sink otwarty od końca sprawdzania bazy
+  if (_phase != HEADER && _phase != BASE && _phase != DONE) _dst->end(false);
+  _phase = DONE;
+  _result = r;
+  return r;
+}
+
+void MeshDeltaApplier::abort() {
+  if (_phase != DONE) _fail(MESH_DELTA_ERR_FORMAT);
+}
+
+MeshDeltaResult MeshDeltaApplier::_emit(const uint8_t *data, size_t len) {
+  if (!_dst->write(data, len)) return _fail(MESH_DELTA_ERR_WRITE);
+  _sha.update(data, len);
+  _written += len;
+  return MESH_DELTA_MORE;
+}
+
+MeshDeltaResult MeshDeltaApplier::_finishIfDone() {
+  if (_written < _hdr.new_size) return MESH_DELTA_MORE;
+
+  uint8_t digest[MESH_DELTA_HASH_LEN];
+  _sha.finish(digest);
+  if (memcmp(digest, _hdr.new_hash, MESH_DELTA_HASH_LEN) != 0) return _fail(MESH_DELTA_ERR_HASH);
+  _phase = DONE; // sink zamykany niżej, nie w _fail
+  _result = _dst->end(true) ? MESH_DELTA_OK : MESH_DELTA_ERR_WRITE;
+  return _result;
+}
+
+MeshDeltaResult MeshDeltaApplier::feed(const uint8_t *data, size_t len) {
+  while (len > 0) {
+    switch (_phase) {
+      case HEADER: {
+        const size_t n = (len < MESH_DELTA_HEADER_LEN - _raw_fill) ? len : MESH_DELTA_HEADER_LEN - _raw_fill;
+        memcpy(_raw + _raw_fill, data, n);
+        _raw_fill += n;
+        data += n;
+        len -= n;
+        if (_raw_fill < MESH_DELTA_HEADER_LEN) break;
+        if (!parseHeader(_raw, _hdr)) return _fail(MESH_DELTA_ERR_FORMAT);
+        if (_hdr.old_size > _src->size()) return _fail(MESH_DELTA_ERR_BASE);
+        _phase = BASE;
+        break;
+      }
+
+      case OP:
+      case COPY_OFF: {
+        const uint8_t b = *data++;
+        --len;
+        if (_varint_shift > 28) return _fail(MESH_DELTA_ERR_FORMAT);
+        _varint |= uint32_t(b & 0x7F) << _varint_shift;
+        _varint_shift += 7;
+        if (b & 0x80) break;
+
+        const uint32_t v = _varint;
+        _varint = 0;
+        _varint_shift = 0;
+
+        if (_phase == OP) {
+          _op_len = v >> 1;
+          if (_op_len == 0 || _op_len > _hdr.new_size - _written) return _fail(MESH_DELTA_ERR_FORMAT);
+          _phase = (v & 1) ? LITERAL : COPY_OFF;
+        } else {
+          const int32_t off = int32_t(v >> 1) ^ -int32_t(v & 1);
+          const int64_t pos = int64_t(_copy_pos) + off;
+          if (pos < 0 || uint64_t(pos) + _op_len > _hdr.old_size) return _fail(MESH_DELTA_ERR_FORMAT);
+          _copy_pos = uint32_t(pos);
+          _phase = COPY;
+        }
+        break;
+      }
+
+      case LITERAL: {
+        const size_t n = (len < _op_len) ? len : _op_len;
+        if (_emit(data, n) != MESH_DELTA_MORE) return _result;
+        data += n;
+        len -= n;
+        _op_len -= uint32_t(n);
+        if (_op_len == 0) {
+          _phase = OP;
+          if (_finishIfDone() != MESH_DELTA_MORE) return _result;
+        }
+        break;
+      }
+
+      default:
+        // dane ponad wants(): zła łatka albo błąd wołającego
+        return _fail(MESH_DELTA_ERR_FORMAT);
+    }
+  }
+  return _result;
+}
+
+MeshDeltaResult MeshDeltaApplier::poll() {
+  if (_phase == BASE) {
+    size_t budget = MESH_DELTA_POLL_BYTES;
+    while (budget > 0 && _base_pos < _hdr.old_size) {
+      size_t n = _hdr.old_size - _base_pos;
+      if (n > sizeof(_buf)) n = sizeof(_buf);
+      if (!_src->read(_base_pos, _buf, n)) return _fail(MESH_DELTA_ERR_READ);
+      _sha.update(_buf, n);
+      _base_pos += uint32_t(n);
+      budget = (budget > n) ? budget - n : 0;
+    }
+    if (_base_pos < _hdr.old_size) return MESH_DELTA_MORE;
+
+    uint8_t digest[MESH_DELTA_HASH_LEN];
+    _sha.finish(digest);
+    if (memcmp(digest, _hdr.old_hash, MESH_DELTA_HASH_LEN) != 0) return _fail(MESH_DELTA_ERR_BASE);
+
+    _sha.reset();
+    if (!_dst->begin(_hdr.new_size)) {
+      _phase = DONE;
+      _result = MESH_DELTA_ERR_WRITE;
+      return _result;
+    }
+    _phase = OP;
+    return _finishIfDone(); // pusty obraz docelowy
+  }
+
+  if (_phase == COPY) {
+    size_t budget = MESH_DELTA_POLL_BYTES;
+    while (budget > 0 && _op_len > 0) {
+      size_t n = _op_len;
+      if (n > sizeof(_buf)) n = sizeof(_buf);
+      if (!_src->read(_copy_pos, _buf, n)) return _fail(MESH_DELTA_ERR_READ);
+      if (_emit(_buf, n) != MESH_DELTA_MORE) return _result;
+      _copy_pos += uint32_t(n);
+      _op_len -= uint32_t(n);
+      budget = (budget > n) ? budget - n : 0;
+    }
+    if (_op_len > 0) return MESH_DELTA_MORE;
+    _phase = OP;
+    return _finishIfDone();
+  }
+
+  return _result;
+}
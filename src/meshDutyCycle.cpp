@@ -0,0 +1,312 @@
+#include "meshDutyCycle.h"
+#include <string.h>
+
+static const uint8_t ZERO_MAC[6] = {0, 0, 0, 0, 0, 0};
+
+static uint8_t popcount8(uint8_t v) {
+  uint8_t n = 0;
+  for (; v; v &= uint8_t(v - 1)) ++n;
+  return n;
+}
+
+// ================== KONSTRUKTOR ==================
+
+MeshDutyCycle::MeshDutyCycle() {
+  memset(_self, 0, sizeof(_self));
+  memset(_topics, 0, sizeof(_topics));
+  memset(_parent, 0, sizeof(_parent));
+  memset(_children, 0, sizeof(_children));
+  memset(_queue, 0, sizeof(_queue));
+}
+
+void MeshDutyCycle::setSelf(const uint8_t mac[6]) {
+  memcpy(_self, mac, 6);
+}
+
+void MeshDutyCycle::setRole(MeshDcRole role, uint32_t now_ms) {
+  _role = role;
+  _awake = false;
+  _ack_seen = false;
+  _end_seen = false;
+  _misses = 0;
+  _has_parent = false;
+  _next_wake_ms = now_ms;   // pierwsza pobudka od razu — szybkie znalezienie rodzica
+  memset(_children, 0, sizeof(_children));
+  memset(_queue, 0, sizeof(_queue));
+}
+
+// ================== WĘZEŁ ŚPIĄCY ==================
+
+void MeshDutyCycle::setSchedule(uint32_t period_ms, uint16_t window_ms) {
+  if (window_ms < 10) window_ms = 10;
+  if (period_ms < 2u * window_ms) period_ms = 2u * window_ms;
+  _period_ms = period_ms;
+  _window_ms = window_ms;
+}
+
+void MeshDutyCycle::setTopics(const uint16_t *ids, size_t count, bool want_all) {
+  // więcej subskrypcji niż mieści ramka → rodzic buforuje wszystko
+  _want_all = want_all || count > MESH_DC_TOPICS;
+  _topic_count = _want_all ? 0 : uint8_t(count);
+  for (size_t i = 0; i < _topic_count; ++i) _topics[i] = ids[i];
+}
+
+MeshDcAction MeshDutyCycle::step(uint32_t now_ms) {
+  if (_role == MESH_DC_PARENT) _expire(now_ms);
+  if (_role != MESH_DC_SLEEPY || _period_ms == 0) return MESH_DC_NONE;
+
+  if (!_awake) {
+    if (int32_t(now_ms - _next_wake_ms) < 0) return MESH_DC_NONE;
+    _awake = true;
+    _ack_seen = false;
+    _end_seen = false;
+    _wake_ms = now_ms;
+    _window_end_ms = now_ms + _window_ms;
+    // harmonogram bez dryfu; po zaległości (długi loop) od teraz
+    _next_wake_ms += _period_ms;
+    if (int32_t(now_ms - _next_wake_ms) >= 0) _next_wake_ms = now_ms + _period_ms;
+    _stats.wakes++;
+    return MESH_DC_WAKE;
+  }
+
+  if (!_end_seen && int32_t(now_ms - _window_end_ms) < 0) return MESH_DC_NONE;
+
+  _awake = false;
+  if (_ack_seen) {
+    _misses = 0;
+  } else if (_has_parent && ++_misses >= MESH_DC_PARENT_MISSES) {
+    _has_parent = false;    // następna pobudka: dowolny rodzic
+    _misses = 0;
+  }
+  return MESH_DC_SLEEP;
+}
+
+void MeshDutyCycle::buildWake(mesh_dc_frame &out) const {
+  memset(&out, 0, sizeof(out));
+  out.magic = MESH_DC_MAGIC;
+  out.kind = MESH_DC_KIND_WAKE;
+  if (_has_parent) memcpy(out.peer, _parent, 6);
+  out.period_ms = _period_ms;
+  out.window_ms = _window_ms;
+  out.flags = _want_all ? MESH_DC_WANT_ALL : 0;
+  out.count = _topic_count;
+  memcpy(out.topics, _topics, sizeof(uint16_t) * _topic_count);
+}
+
+bool MeshDutyCycle::wakeForSend(uint32_t now_ms) {
+  if (_role != MESH_DC_SLEEPY) return false;
+  if (_awake) {
+    if (int32_t(now_ms + MESH_DC_TX_MS - _window_end_ms) > 0) _window_end_ms = now_ms + MESH_DC_TX_MS;
+    return false;
+  }
+  // okno tylko na nadanie: bez WAKE do rodzica i bez liczenia braku ACK
+  _awake = true;
+  _ack_seen = true;
+  _end_seen = false;
+  _wake_ms = now_ms;
+  _window_end_ms = now_ms + MESH_DC_TX_MS;
+  return true;
+}
+
+uint32_t MeshDutyCycle::sleepMs(uint32_t now_ms) const {
+  if (_role != MESH_DC_SLEEPY || _awake) return 0;
+  const int32_t left = int32_t(_next_wake_ms - now_ms);
+  return left > 0 ? uint32_t(left) : 0;
+}
+
+// ================== RODZIC ==================
+
+bool MeshDutyCycle::_wants(const Child &c, uint16_t topic_id) const {
+  if (c.want_all) return true;
+  for (size_t i = 0; i < c.topic_count; ++i) {
+    if (c.topics[i] == topic_id) return true;
+  }
+  return false;
+}
+
+size_t MeshDutyCycle::_pendingFor(size_t idx) const {
+  size_t n = 0;
+  for (size_t i = 0; i < MESH_DC_QUEUE; ++i) {
+    if (_queue[i].mask & (1u << idx)) ++n;
+  }
+  return n;
+}
+
+void MeshDutyCycle::_dropChild(size_t idx) {
+  _children[idx].used = false;
+  for (size_t i = 0; i < MESH_DC_QUEUE; ++i) _queue[i].mask &= uint8_t(~(1u << idx));
+}
+
+void MeshDutyCycle::_expire(uint32_t now_ms) {
+  for (size_t i = 0; i < MESH_DC_CHILDREN; ++i) {
+    const Child &c = _children[i];
+    if (!c.used) continue;
+    // dwie przegapione pobudki z rzędu = dziecko odeszło albo zmieniło rodzica
+    if (now_ms - c.wake_ms > 2 * c.period_ms + c.window_ms + 1000) {
+      _dropChild(i);
+      _stats.children_lost++;
+    }
+  }
+}
+
+size_t MeshDutyCycle::offer(const uint8_t *frame, size_t len, uint16_t topic_id,
+                            const uint8_t *target, const uint8_t *source, uint32_t now_ms) {
+  (void)now_ms;
+  if (_role != MESH_DC_PARENT || !frame || len == 0 || len > MESH_DC_FRAME_MAX) return 0;
+
+  uint8_t mask = 0;
+  for (size_t i = 0; i < MESH_DC_CHILDREN; ++i) {
+    const Child &c = _children[i];
+    if (!c.used || (source && memcmp(source, c.mac, 6) == 0)) continue;
+    const bool match = target ? memcmp(target, c.mac, 6) == 0 : _wants(c, topic_id);
+    if (match) mask |= uint8_t(1u << i);
+  }
+  if (!mask) return 0;
+
+  // wolny slot albo najstarsza ramka wypada (świeże dane ważniejsze)
+  Slot *slot = nullptr;
+  for (size_t i = 0; i < MESH_DC_QUEUE; ++i) {
+    if (!_queue[i].mask) {
+      slot = &_queue[i];
+      break;
+    }
+    if (!slot || int32_t(_queue[i].seq - slot->seq) < 0) slot = &_queue[i];
+  }
+  _stats.dropped += popcount8(slot->mask);
+
+  slot->mask = mask;
+  slot->len = uint8_t(len);
+  slot->seq = _seq++;
+  memcpy(slot->data, frame, len);
+  const uint8_t n = popcount8(mask);
+  _stats.buffered += n;
+  return n;
+}
+
+size_t MeshDutyCycle::nextBurst(uint32_t now_ms, uint8_t out[MESH_DC_FRAME_MAX]) {
+  if (_role != MESH_DC_PARENT) return 0;
+
+  for (size_t i = 0; i < MESH_DC_CHILDREN; ++i) {
+    Child &c = _children[i];
+    if (!c.used || !c.awake) continue;
+    // dziecko nie słucha dłużej niż MESH_DC_WINDOW_MAX_MS; reszta przy następnej pobudce
+    if (now_ms - c.wake_ms >= MESH_DC_WINDOW_MAX_MS) {
+      c.awake = false;
+      continue;
+    }
+
+    const uint8_t bit = uint8_t(1u << i);
+    Slot *slot = nullptr;
+    for (size_t k = 0; k < MESH_DC_QUEUE; ++k) {
+      if ((_queue[k].mask & bit) && (!slot || int32_t(_queue[k].seq - slot->seq) < 0)) slot = &_queue[k];
+    }
+    if (slot) {
+      memcpy(out, slot->data, slot->len);
+      slot->mask &= uint8_t(~bit);
+      _stats.delivered++;
+      return slot->len;
+    }
+
+    mesh_dc_frame end;
+    memset(&end, 0, sizeof(end));
+    end.magic = MESH_DC_MAGIC;
+    end.kind = MESH_DC_KIND_END;
+    memcpy(end.peer, c.mac, 6);
+    memcpy(out, &end, sizeof(end));
+    c.awake = false;
+    return sizeof(end);
+  }
+  return 0;
+}
+
+size_t MeshDutyCycle::childCount() const {
+  size_t n = 0;
+  for (size_t i = 0; i < MESH_DC_CHILDREN; ++i) {
+    if (_children[i].used) ++n;
+  }
+  return n;
+}
+
+size_t MeshDutyCycle::queued() const {
+  size_t n = 0;
+  for (size_t i = 0; i < MESH_DC_QUEUE; ++i) {
+    if (_queue[i].mask) ++n;
+  }
+  return n;
+}
+
+bool MeshDutyCycle::_onWake(const uint8_t from[6], const mesh_dc_frame &f, uint32_t now_ms,
+                            mesh_dc_frame &reply) {
+  int idx = -1;
+  int free_idx = -1;
+  for (size_t i = 0; i < MESH_DC_CHILDREN; ++i) {
+    if (_children[i].used && memcmp(_children[i].mac, from, 6) == 0) idx = int(i);
+    if (!_children[i].used && free_idx < 0) free_idx = int(i);
+  }
+
+  // dziecko wybrało innego rodzica
+  if (memcmp(f.peer, ZERO_MAC, 6) != 0 && memcmp(f.peer, _self, 6) != 0) {
+    if (idx >= 0) _dropChild(size_t(idx));
+    return false;
+  }
+  if (idx < 0) {
+    if (free_idx < 0) return false;  // brak miejsca: dziecko znajdzie innego rodzica
+    idx = free_idx;
+    memset(&_children[idx], 0, sizeof(Child));
+    _children[idx].used = true;
+    memcpy(_children[idx].mac, from, 6);
+  }
+
+  Child &c = _children[idx];
+  c.awake = true;
+  c.wake_ms = now_ms;
+  c.period_ms = f.period_ms;
+  c.window_ms = f.window_ms;
+  c.want_all = (f.flags & MESH_DC_WANT_ALL) != 0 || f.count > MESH_DC_TOPICS;
+  c.topic_count = c.want_all ? 0 : f.count;
+  memcpy(c.topics, f.topics, sizeof(uint16_t) * c.topic_count);
+  _stats.wakes++;
+
+  memset(&reply, 0, sizeof(reply));
+  reply.magic = MESH_DC_MAGIC;
+  reply.kind = MESH_DC_KIND_ACK;
+  memcpy(reply.peer, from, 6);
+  const size_t pending = _pendingFor(size_t(idx));
+  reply.count = uint8_t(pending > 255 ? 255 : pending);
+  _stats.acks++;
+  return true;
+}
+
+// ================== RAMKI ==================
+
+bool MeshDutyCycle::onFrame(const uint8_t from[6], const uint8_t *data, size_t len,
+                            uint32_t now_ms, mesh_dc_frame &reply) {
+  if (len != sizeof(mesh_dc_frame) || data[0] != MESH_DC_MAGIC) return false;
+  mesh_dc_frame f;
+  memcpy(&f, data, sizeof(f));
+
+  if (f.kind == MESH_DC_KIND_WAKE) {
+    return _role == MESH_DC_PARENT && _onWake(from, f, now_ms, reply);
+  }
+
+  // ACK / END: tylko do nas, tylko w oknie
+  if (_role != MESH_DC_SLEEPY || !_awake || memcmp(f.peer, _self, 6) != 0) return false;
+  if (f.kind == MESH_DC_KIND_ACK) {
+    if (!_has_parent) {
+      memcpy(_parent, from, 6);   // pierwszy rodzic, który odpowiedział
+      _has_parent = true;
+    }
+    if (memcmp(from, _parent, 6) != 0) return false;
+    _ack_seen = true;
+    _misses = 0;
+    _stats.acks++;
+    // czekamy na całą kolejkę, ale nie dłużej niż MESH_DC_WINDOW_MAX_MS od pobudki
+    uint32_t until = now_ms + uint32_t(f.count + 1) * MESH_DC_FRAME_MS;
+    const uint32_t cap = _wake_ms + MESH_DC_WINDOW_MAX_MS;
+    if (int32_t(until - cap) > 0) until = cap;
+    if (int32_t(until - _window_end_ms) > 0) _window_end_ms = until;
+  } else if (f.kind == MESH_DC_KIND_END) {
+    if (_has_parent && memcmp(from, _parent, 6) == 0) _end_seen = true;
+  }
+  return false;
+}
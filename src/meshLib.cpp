@@ -12,6 +12,15 @@
   }
 #endif
 
+#if MESH_OTA_DELTA
+  #if defined(ARDUINO_ARCH_ESP32)
+    #include <Update.h>
+    #include <esp_ota_ops.h>
+  #else
+    #include <Updater.h>
+  #endif
+#endif
+
 // Broadcast FF:FF:FF:FF:FF:FF
 static const uint8_t BROADCAST_ADDR[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
 
@@ -45,6 +54,13 @@ MeshLib::MeshLib(ReceiveCallback cb)
   _channel      = 1;
   _dedup_idx    = 0;
   // _dedup jest wyzerowany przez in-class init / statyczną inicjalizację
+
+  registerTopic(MESH_TOPIC_DISCOVER_GET);
+  registerTopic(MESH_TOPIC_DISCOVER_POST);
+  registerTopic(MESH_TOPIC_OTA_START);
+  registerTopic(MESH_TOPIC_REBOOT);
+  registerTopic(MESH_TOPIC_RETAIN_GET);
+  registerTopic(MESH_TOPIC_AGG_QUERY);
 }
 
 void MeshLib::_lockState() {
@@ -76,21 +92,95 @@ void MeshLib::initMesh(const char *name,
   _topics_count      = topics_count;
   _channel           = wifi_channel ? wifi_channel : 1;
 
-#if defined(ARDUINO_ARCH_ESP32)
+  _power_save       = power_save;
+
+  // filtr ogłaszany sąsiadom (tryb przycinania floodu)
+  _subfilter.clearLocal();
+  _subfilter.setWantAll(_topics_count == 0);
+
+  for (int i = 0; i < _topics_count; ++i) {
+    // "#xxxx" = subskrypcja surowego ID (topic bez znanej nazwy); kolizję
+    // ID z innym znanym topicem zgłasza registerTopic
+    uint16_t id;
+    if (!_rawTopicId(_subscribed_topics[i], id)) {
+      (void)registerTopic(_subscribed_topics[i]);
+      id = meshTopicId(_subscribed_topics[i]);
+    }
+    if (i < MESH_MAX_SUBSCRIPTIONS) _sub_ids[i] = id;
+    _subfilter.addLocal(id);
+  }
+
+  _configureRadio();
+  if (!_startEspNow()) {
+    while (true) delay(1000);
+  }
+
+  uint8_t mac_bin[6];
+  _selfMac(mac_bin);
+  _backbone.setSelf(mac_bin);
+  _dc.setSelf(mac_bin);
+
+  // ziarno RNG: MAC + czas uruchomienia, żeby MID-y były losowe per urządzenie
+  uint32_t seed = (uint32_t(mac_bin[2]) << 24) |
+                  (uint32_t(mac_bin[3]) << 16) |
+                  (uint32_t(mac_bin[4]) << 8)  |
+                  uint32_t(mac_bin[5]);
+  seed ^= millis();
+  randomSeed(seed);
+
+  MESH_LOG("✅ MeshLib: %s ready (ch=%u, MAC=%s)\n",
+           _name ? _name : "node", _channel, WiFi.macAddress().c_str());
+}
 
+// ================== RADIO / ESP-NOW ==================
+
+void MeshLib::_configureRadio() {
+#if defined(ARDUINO_ARCH_ESP32)
   WiFi.mode(WIFI_STA);
-  if (power_save) {
+  if (_power_save) {
     esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
   } else {
     esp_wifi_set_ps(WIFI_PS_NONE);
   }
   esp_wifi_set_max_tx_power(78); // ~19.5 dBm
-  esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_LR);
+  uint8_t protocol = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_LR;
+  if (_adaptive_rate) protocol |= WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N;
+  esp_wifi_set_protocol(WIFI_IF_STA, protocol);
   esp_wifi_set_channel(_channel, WIFI_SECOND_CHAN_NONE);
 
+  // RSSI sąsiadów zbieramy z ramek ESP-NOW w trybie promiscuous
+  if (_adaptive_rate) {
+    wifi_promiscuous_filter_t filter{};
+    filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(&_promiscThunk);
+    esp_wifi_set_promiscuous(true);
+  } else {
+    esp_wifi_set_promiscuous(false);
+  }
+  _lockState();
+  _cur_rate = MESH_PHY_COUNT; // sterownik wraca do domyślnego rate
+  _cur_power_q = 78;
+  _unlockState();
+#elif defined(ARDUINO_ARCH_ESP8266)
+  WiFi.mode(WIFI_STA);
+  if (_power_save) {
+    WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+  } else {
+    WiFi.setSleepMode(WIFI_NONE_SLEEP);
+  }
+  WiFi.setOutputPower(20.5f);
+  wifi_set_channel(_channel);
+#endif
+}
+
+bool MeshLib::_startEspNow() {
+  if (_espnow_active) return true;
+
+#if defined(ARDUINO_ARCH_ESP32)
   if (esp_now_init() != ESP_OK) {
     MESH_LOG("❌ ESP-NOW init failed (ESP32)\n");
-    while (true) delay(1000);
+    return false;
   }
   esp_now_register_recv_cb(&_recvThunk);
 
@@ -101,21 +191,10 @@ void MeshLib::initMesh(const char *name,
   if (esp_now_add_peer(&peer) != ESP_OK) {
     MESH_LOG("❌ esp_now_add_peer failed (ESP32)\n");
   }
-
 #elif defined(ARDUINO_ARCH_ESP8266)
-
-  WiFi.mode(WIFI_STA);
-  if (power_save) {
-    WiFi.setSleepMode(WIFI_MODEM_SLEEP);
-  } else {
-    WiFi.setSleepMode(WIFI_NONE_SLEEP);
-  }
-  WiFi.setOutputPower(20.5f);
-  wifi_set_channel(_channel);
-
   if (esp_now_init() != 0) {
     MESH_LOG("❌ ESP-NOW init failed (ESP8266)\n");
-    while (true) delay(1000);
+    return false;
   }
   esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
   esp_now_register_recv_cb(&_recvThunk);
@@ -123,30 +202,29 @@ void MeshLib::initMesh(const char *name,
   if (esp_now_add_peer((uint8_t*)BROADCAST_ADDR, ESP_NOW_ROLE_COMBO, _channel, NULL, 0) != 0) {
     MESH_LOG("❌ esp_now_add_peer failed (ESP8266)\n");
   }
-
 #endif
 
-  uint8_t mac_bin[6];
-#if defined(ARDUINO_ARCH_ESP32)
-  esp_wifi_get_mac(WIFI_IF_STA, mac_bin);
-#else
-  wifi_get_macaddr(STATION_IF, mac_bin);
-#endif
-
-  // ziarno RNG: MAC + czas uruchomienia, żeby MID-y były losowe per urządzenie
-  uint32_t seed = (uint32_t(mac_bin[2]) << 24) |
-                  (uint32_t(mac_bin[3]) << 16) |
-                  (uint32_t(mac_bin[4]) << 8)  |
-                  uint32_t(mac_bin[5]);
-  seed ^= millis();
-  randomSeed(seed);
+  _espnow_active = true;
+  return true;
+}
 
-  MESH_LOG("✅ MeshLib: %s ready (ch=%u, MAC=%s)\n",
-           _name ? _name : "node", _channel, WiFi.macAddress().c_str());
+void MeshLib::_stopEspNow() {
+  if (!_espnow_active) return;
+  esp_now_deinit();
+  _espnow_active = false;
 }
 
 // ================== WYSYŁANIE ==================
 
+int MeshLib::_sendRaw(const uint8_t *dest, const uint8_t *data, size_t len) {
+  _applyTxRate();
+#if defined(ARDUINO_ARCH_ESP32)
+  return (int)esp_now_send(dest, data, len);
+#else
+  return esp_now_send((uint8_t*)dest, (uint8_t*)data, (uint8_t)len);
+#endif
+}
+
 bool MeshLib::_sendMessage(const standard_mesh_message &message) {
   standard_mesh_message m = message;
   if (m.ttl <= 0) m.ttl = MESH_DEFAULT_TTL;  // domyślny TTL
@@ -155,17 +233,66 @@ bool MeshLib::_sendMessage(const standard_mesh_message &message) {
   _fillMid(m);    // NOWE: nadaj MID, jeżeli brak
   (void)_seenAndRemember(m); // zapisz własny MID, by nie forwardować po zawróceniu
 
-#if defined(ARDUINO_ARCH_ESP32)
-  esp_err_t r = esp_now_send(BROADCAST_ADDR,
-                             reinterpret_cast<const uint8_t*>(&m),
-                             sizeof(m));
-  return (r == ESP_OK);
-#else
-  int r = esp_now_send((uint8_t*)BROADCAST_ADDR,
-                       (uint8_t*)&m,
-                       (uint8_t)sizeof(m));
-  return (r == 0);
-#endif
+  FrameMeta meta{};
+  _topicMeta(m.topic, meta);
+  meta.compact = _compact_frames;
+  if (_net_coding) {
+    // relay może XOR-ować naszą wiadomość z inną — trzymamy treść do dekodowania
+    standard_mesh_message body;
+    _codedBody(m, meta, body);
+    _lockState();
+    _coder.remember(m.mid, reinterpret_cast<const uint8_t*>(&body));
+    _unlockState();
+  }
+  if (_dc.role() == MESH_DC_PARENT) _offerSleepy(m, meta);
+  if (_dc.role() == MESH_DC_SLEEPY && !_espnow_active && _ota_state == MESH_OTA_IDLE) {
+    // nadanie w czasie snu: krótkie okno poza harmonogramem
+    _lockState();
+    const bool wake = _dc.wakeForSend(millis());
+    _unlockState();
+    if (wake) _radioWake();
+  }
+  if (!_espnow_active) return false; // np. OTA na innym kanale niż mesh
+
+  if (_sendFrame(m, meta) != 0) return false;
+  if (_adaptive_rate && m.ttl > 1 && _echoExpected(m)) {
+    // sąsiedzi przekażą ją dalej — echo (albo jego brak) to wynik dostarczenia
+    _lockState();
+    _link.onBroadcast(m.mid, millis());
+    _unlockState();
+  }
+  return true;
+}
+
+// Sąsiad milczy też z wyboru, nie tylko przez stratę — wtedy brak echa nie
+// może obniżać rate. Tryby są włączane na całej sieci, więc lokalne
+// ustawienia mówią, czy sąsiedzi forwardują każdą wiadomość.
+bool MeshLib::_echoExpected(const standard_mesh_message &msg) const {
+  if (_backbone_on) return false;       // liście szkieletu nie forwardują
+  if (_sub_pruning && _equals(msg.type, MESH_TYPE_DATA)) return false; // sąsiad bez subskrybenta milczy
+  if (_limiter.enabled()) return false; // forward mógł odpaść w limiterze
+  return true;
+}
+
+int MeshLib::_sendFrame(const standard_mesh_message &msg, const FrameMeta &meta) {
+  uint8_t frame[MESH_DC_FRAME_MAX];
+  const size_t len = _encodeFrame(msg, meta, frame);
+  return _sendRaw(BROADCAST_ADDR, frame, len);
+}
+
+size_t MeshLib::_encodeFrame(const standard_mesh_message &msg, const FrameMeta &meta,
+                             uint8_t out[MESH_DC_FRAME_MAX]) const {
+  if (meta.compact) {
+    mesh_compact_frame f;
+    const size_t len = _encodeCompact(msg, meta, f);
+    if (len) {
+      memcpy(out, &f, len);
+      return len;
+    }
+    // typ spoza ramki kompaktowej → stary format
+  }
+  memcpy(out, &msg, sizeof(msg));
+  return sizeof(msg);
 }
 
 bool MeshLib::sendMessage(const char *topic, const char *payload, int ttl) {
@@ -199,6 +326,17 @@ bool MeshLib::sendDiscover(int ttl) {
   return _sendMessage(msg);
 }
 
+bool MeshLib::sendRetained(const char *topic, const char *payload, int ttl) {
+  standard_mesh_message m{};
+  m.ttl = (ttl > 0) ? ttl : MESH_DEFAULT_TTL;
+  _fillSender(m);
+  strncpy(m.type,  MESH_TYPE_RETAIN, sizeof(m.type) - 1);
+  if (topic)   strncpy(m.topic,   topic,   sizeof(m.topic) - 1);
+  if (payload) strncpy(m.payload, payload, sizeof(m.payload) - 1);
+  _onRetained(m); // własna wartość też trafia do lokalnego cache
+  return _sendMessage(m);
+}
+
 // ================== RECV THUNK ==================
 
 #if defined(ARDUINO_ARCH_ESP32)
@@ -216,22 +354,99 @@ void MeshLib::_recvThunk(uint8_t *mac, uint8_t *data, uint8_t len) {
 // ================== ODBIÓR I FORWARDING ==================
 
 void MeshLib::_handleReceive(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len != (int)sizeof(standard_mesh_message)) return;
-
-  standard_mesh_message msg{};
-  memcpy(&msg, data, sizeof(msg));
-
   // self MAC check (binarne)
   uint8_t my[6];
-#if defined(ARDUINO_ARCH_ESP32)
-  esp_wifi_get_mac(WIFI_IF_STA, my);
-#else
-  wifi_get_macaddr(STATION_IF, my);
-#endif
+  _selfMac(my);
   if (memcmp(my, mac, 6) == 0) return;  // ignoruj własne ramki
+  if (len <= 0) return;
+
+  if (_sub_pruning) {
+    _lockState();
+    _subfilter.onHeard(mac, millis());
+    _unlockState();
+  }
+
+  // najpierw magic: stary format zaczyna się tekstem MAC-a nadawcy, więc
+  // nie koliduje z 0xC0..0xC5, za to długość ramki XOR może wypaść 244 B
+  if (len <= (int)sizeof(mesh_compact_frame) && data[0] == MESH_CF_MAGIC) {
+    standard_mesh_message msg{};
+    FrameMeta meta{};
+    if (_decodeCompact(data, len, msg, meta)) _processMessage(mac, msg, meta);
+  } else if (data[0] == MESH_SF_MAGIC) {
+    if (!_sub_pruning) return;
+    _lockState();
+    const bool ok = _subfilter.onAdvert(mac, data, size_t(len), millis());
+    if (ok) _sf_changed = true; // poziomy wyżej mogą się zmienić → szybsze ogłoszenie
+    _unlockState();
+  } else if (data[0] == MESH_BB_MAGIC) {
+    if (!_backbone_on) return;
+    bool is_new = false;
+    _lockState();
+    _backbone.onHello(mac, data, size_t(len), millis(), &is_new);
+    if (is_new) _bb_changed = true; // nowy sąsiad → szybsze hello, szybsza zbieżność
+    _unlockState();
+  } else if (len == (int)sizeof(mesh_agg_reply) && data[0] == MESH_AGG_MAGIC) {
+    mesh_agg_reply reply;
+    memcpy(&reply, data, sizeof(reply));
+    _handleAggReply(reply);
+  } else if (data[0] == MESH_DC_MAGIC) {
+    if (_dc.role() == MESH_DC_OFF) return;
+    mesh_dc_frame reply;
+    _lockState();
+    const bool ack = _dc.onFrame(mac, data, size_t(len), millis(), reply);
+    _unlockState();
+    // ACK od razu: dziecko słucha tylko przez window_ms
+    if (ack) (void)_sendRaw(BROADCAST_ADDR, reinterpret_cast<const uint8_t*>(&reply), sizeof(reply));
+  } else if (len >= (int)MESH_NC_HEADER_LEN && len <= (int)MESH_NC_FRAME_LEN &&
+             data[0] == MESH_NC_MAGIC) {
+    mesh_coded_frame frame;
+    memcpy(&frame, data, size_t(len));
+    _handleCoded(mac, frame, size_t(len));
+  } else if (len == (int)sizeof(standard_mesh_message)) {
+    standard_mesh_message msg{};
+    memcpy(&msg, data, sizeof(msg));
+    FrameMeta meta{};
+    _topicMeta(msg.topic, meta);
+    meta.compact = false;
+    meta.topic_inline = true;
+    _processMessage(mac, msg, meta);
+  }
+}
+
+void MeshLib::_processMessage(const uint8_t *mac, standard_mesh_message &msg, const FrameMeta &meta) {
+  if (_net_coding) {
+    // nadawca ramki i autor wiadomości mają ją na pewno
+    uint8_t origin[6];
+    const uint32_t now = millis();
+    _lockState();
+    _coder.onHeard(mac, msg.mid, now);
+    if (meshParseMac(msg.sender, origin)) _coder.onHeard(origin, msg.mid, now);
+    _unlockState();
+  }
 
   // dedupe po MID
   if (_seenAndRemember(msg)) {
+    // echo naszej wiadomości = sąsiad ją odebrał (pasywne potwierdzenie)
+    if (_adaptive_rate) {
+      uint8_t origin[6];
+      uint8_t my[6];
+      _selfMac(my);
+      if (meshParseMac(msg.sender, origin) && memcmp(origin, my, 6) == 0) {
+        _lockState();
+        _link.onEcho(mac, msg.mid, millis());
+        _unlockState();
+      }
+    }
+    // szkielet: pierwsza kopia przyszła od nie-selektora, ta od selektora
+    if (_backbone_on) {
+      _lockState();
+      const bool late = _backbone.relayDuplicate(mac, msg.mid, millis());
+      _unlockState();
+      if (late) {
+        _forward(mac, msg, meta, true);
+        return;
+      }
+    }
 #if MESH_LIB_LOG_ENABLED
     MESH_LOG("↩️ dup drop mid=%lu type=%s topic=%s\n",
              (unsigned long)msg.mid, msg.type, msg.topic);
@@ -239,27 +454,65 @@ void MeshLib::_handleReceive(const uint8_t *mac, const uint8_t *data, int len) {
     return;
   }
 
+  if (_net_coding) {
+    standard_mesh_message body;
+    _codedBody(msg, meta, body);
+    _lockState();
+    _coder.remember(msg.mid, reinterpret_cast<const uint8_t*>(&body));
+    _unlockState();
+  }
+
+  const bool replay = _equals(msg.type, MESH_TYPE_RETAIN_REPLAY);
+  if (replay || _equals(msg.type, MESH_TYPE_RETAIN)) {
+    // szukanie cache kończy tylko wartość pasująca do zapytania
+    if (_retain_ring && (_retain_filter[0] == '\0' || _equals(_retain_filter, msg.topic))) {
+      _retain_answered = true;
+    }
+    // inny cache odpowiedział pierwszy → nasza odpowiedź zbędna
+    _lockState();
+    if (_retain_reply.active && !_retain_reply.started &&
+        (_retain_reply.filter[0] == '\0' || _equals(_retain_reply.filter, msg.topic))) {
+      _retain_reply.active = false;
+    }
+    _unlockState();
+    _onRetained(msg, replay);
+  }
+
   // auto-CMD
   if (_equals(msg.type, MESH_TYPE_CMD)) {
-    _autoHandleCmd(msg);
+    _autoHandleCmd(mac, msg, meta);
   }
 
-  // filtr subów → callback
+  // filtr subów → callback (porównanie ID; string tylko przy topicu z ramki)
   bool subscribed = (_topics_count == 0);
   for (int i = 0; !subscribed && i < _topics_count; ++i) {
-    if (_equals(_subscribed_topics[i], msg.topic)) subscribed = true;
+    if (i >= MESH_MAX_SUBSCRIPTIONS) {
+      subscribed = _equals(_subscribed_topics[i], msg.topic);
+    } else if (_sub_ids[i] == meta.topic_id) {
+      subscribed = !meta.topic_inline || _equals(_subscribed_topics[i], msg.topic);
+    }
   }
   if (subscribed && _callback) {
     _callback(msg);
   }
 
-  // forward z TTL + krótki backoff
+  // rodzic: kopia dla śpiących dzieci, zanim forward zmieni TTL
+  if (_dc.role() == MESH_DC_PARENT) _offerSleepy(msg, meta);
+
+  _forward(mac, msg, meta, false);
+}
+
+// forward z TTL + krótki backoff; late = duplikat od selektora MPR po
+// kopii, przy której byliśmy liściem (decyzja szkieletu już zapadła)
+void MeshLib::_forward(const uint8_t *mac, standard_mesh_message &msg, const FrameMeta &meta, bool late) {
   if (msg.ttl > 0) {
     msg.ttl -= 1;
     if (msg.ttl > 0) {
+      // węzeł śpiący słucha tylko w oknach — jako relay gubiłby wiadomości
+      if (_dc.role() == MESH_DC_SLEEPY) return;
       // CMD packets with target MAC: forward tylko jeśli nie dla nas
       if (_equals(msg.type, MESH_TYPE_CMD) &&
-          (_equals(msg.topic, MESH_TOPIC_OTA_START) || _equals(msg.topic, MESH_TOPIC_REBOOT))) {
+          (_topicIs(meta, msg, MESH_TID_OTA_START) || _topicIs(meta, msg, MESH_TID_REBOOT))) {
         char target_mac[18];
         if (_parseTargetMac(msg.payload, target_mac, sizeof(target_mac)) && _isForUs(target_mac)) {
 #if MESH_LIB_LOG_ENABLED
@@ -268,42 +521,586 @@ void MeshLib::_handleReceive(const uint8_t *mac, const uint8_t *data, int len) {
           return;
         }
       }
+      if (_backbone_on && !late) {
+        _lockState();
+        const bool relay = _backbone.shouldRelay(mac, msg.mid, millis());
+        _unlockState();
+        if (!relay) {
+#if MESH_LIB_LOG_ENABLED
+          MESH_LOG("🍃 leaf: mid=%lu not relayed (not MPR of sender)\n", (unsigned long)msg.mid);
+#endif
+          return;
+        }
+      }
+      if (_sub_pruning && _equals(msg.type, MESH_TYPE_DATA)) {
+        _lockState();
+        const bool wanted = _subfilter.shouldForward(meta.topic_id, msg.ttl, millis());
+        _unlockState();
+        if (!wanted) {
+#if MESH_LIB_LOG_ENABLED
+          MESH_LOG("✂️ pruned: mid=%lu topic=%s (no subscriber within %d hops)\n",
+                   (unsigned long)msg.mid, msg.topic, msg.ttl);
+#endif
+          return;
+        }
+      }
+      if (!_admitForward(mac, msg, meta)) return;
 #if MESH_LIB_LOG_ENABLED
       MESH_LOG("↪️ forward: mid=%lu type=%s topic=%s ttl=%d\n",
                (unsigned long)msg.mid, msg.type, msg.topic, msg.ttl);
 #endif
+      if (_net_coding && _queueForward(msg, meta)) return; // wyśle loop(), może w parze XOR
 #if defined(ARDUINO_ARCH_ESP32)
       uint32_t us = 1000 + (esp_random() % 3000);
 #else
       uint32_t us = 1000 + (random() % 3000);
 #endif
       delayMicroseconds(us);
-#if defined(ARDUINO_ARCH_ESP32)
-      esp_err_t r = esp_now_send(BROADCAST_ADDR, (uint8_t*)&msg, sizeof(msg));
-      if (r != ESP_OK) {
-        MESH_LOG("⚠️ forward send failed: mid=%lu err=%d\n", (unsigned long)msg.mid, r);
-      }
-#else
-      int r = esp_now_send((uint8_t*)BROADCAST_ADDR,
-                           (uint8_t*)&msg,
-                           (uint8_t)sizeof(msg));
+      int r = _sendFrame(msg, meta); // w formacie, w jakim przyszła
       if (r != 0) {
         MESH_LOG("⚠️ forward send failed: mid=%lu err=%d\n", (unsigned long)msg.mid, r);
       }
+    }
+  }
+}
+
+// ================== NETWORK CODING ==================
+
+void MeshLib::setNetworkCoding(bool enabled) {
+  _lockState();
+  _net_coding = enabled;
+  if (!enabled) {
+    for (int i = 0; i < MESH_NC_QUEUE; ++i) _fwd_queue[i].used = false;
+  }
+  _unlockState();
+}
+
+bool MeshLib::_queueForward(const standard_mesh_message &msg, const FrameMeta &meta) {
+  const uint32_t due = millis() + MESH_NC_HOLD_MS + (rand32() % 4); // + jitter jak backoff
+  bool queued = false;
+  _lockState();
+  for (int i = 0; i < MESH_NC_QUEUE; ++i) {
+    if (!_fwd_queue[i].used) {
+      _fwd_queue[i].msg = msg;
+      _fwd_queue[i].meta = meta;
+      _fwd_queue[i].due_ms = due;
+      _fwd_queue[i].used = true;
+      queued = true;
+      break;
+    }
+  }
+  _unlockState();
+  return queued; // pełna kolejka → forward od razu, bez kodowania
+}
+
+void MeshLib::_flushForwards() {
+  if (!_net_coding) return;
+  const uint32_t now = millis();
+
+  for (int i = 0; i < MESH_NC_QUEUE; ++i) {
+    standard_mesh_message a{};
+    standard_mesh_message b{};
+    FrameMeta meta_a{};
+    FrameMeta meta_b{};
+    bool have_a = false;
+    bool have_b = false;
+    int partner = -1;
+
+    _lockState();
+    if (_fwd_queue[i].used && int32_t(now - _fwd_queue[i].due_ms) >= 0) {
+      a = _fwd_queue[i].msg;
+      meta_a = _fwd_queue[i].meta;
+      _fwd_queue[i].used = false;
+      have_a = true;
+      // partner: dowolna inna oczekująca wiadomość, którą każdy sąsiad zdekoduje
+      for (int j = 0; j < MESH_NC_QUEUE; ++j) {
+        if (_fwd_queue[j].used && _coder.canCombine(a.mid, _fwd_queue[j].msg.mid, now)) {
+          b = _fwd_queue[j].msg;
+          meta_b = _fwd_queue[j].meta;
+          partner = j;
+          have_b = true;
+          break;
+        }
+      }
+    }
+    _unlockState();
+
+    if (!have_a || !_espnow_active) continue;
+
+    mesh_coded_frame f;
+    size_t coded_len = 0;
+    if (have_b) {
+      standard_mesh_message body_a, body_b;
+      _codedBody(a, meta_a, body_a);
+      _codedBody(b, meta_b, body_b);
+      coded_len = MeshNetCoder::encode(f,
+                                       a.mid, int8_t(a.ttl > 127 ? 127 : a.ttl), reinterpret_cast<const uint8_t*>(&body_a),
+                                       b.mid, int8_t(b.ttl > 127 ? 127 : b.ttl), reinterpret_cast<const uint8_t*>(&body_b));
+      // Body XOR ma układ standard_mesh_message (topic 64 B w środku), więc
+      // dla krótkich ramek kompaktowych bywa dłuższe niż dwie osobne ramki
+      const uint32_t kbps = _txKbps();
+      have_b = MeshRateLimiter::airtimeUs(coded_len, kbps) <
+               MeshRateLimiter::airtimeUs(_frameLen(a, meta_a), kbps) +
+               MeshRateLimiter::airtimeUs(_frameLen(b, meta_b), kbps);
+      if (have_b) {
+        // partner schodzi z kolejki dopiero teraz — bez XOR czeka dalej na
+        // swój termin; wpisy zdejmuje tylko loop(), callback odbioru tylko dodaje
+        _lockState();
+        _fwd_queue[partner].used = false;
+        _unlockState();
+      }
+    }
+
+    int r;
+    if (have_b) {
+      // odbiorca przekaże zdekodowaną wiadomość dalej w jej pierwotnym formacie
+      f.flags = uint8_t((meta_a.compact      ? MESH_NC_A_COMPACT    : 0) |
+                        (meta_a.topic_inline ? MESH_NC_A_INLINE     : 0) |
+                        (meta_a.compressed   ? MESH_NC_A_COMPRESSED : 0) |
+                        (meta_b.compact      ? MESH_NC_B_COMPACT    : 0) |
+                        (meta_b.topic_inline ? MESH_NC_B_INLINE     : 0) |
+                        (meta_b.compressed   ? MESH_NC_B_COMPRESSED : 0));
+      r = _sendRaw(BROADCAST_ADDR, reinterpret_cast<const uint8_t*>(&f), coded_len);
+      _lockState();
+      _coder.stats().coded_sent++;
+      _unlockState();
+#if MESH_LIB_LOG_ENABLED
+      MESH_LOG("🔀 coded forward: mid=%lu ^ mid=%lu\n", (unsigned long)a.mid, (unsigned long)b.mid);
 #endif
+    } else {
+      r = _sendFrame(a, meta_a);
+      _lockState();
+      _coder.stats().plain_sent++;
+      _unlockState();
     }
+    if (r != 0) {
+      MESH_LOG("⚠️ forward send failed: mid=%lu err=%d\n", (unsigned long)a.mid, r);
+    }
+  }
+}
+
+void MeshLib::_handleCoded(const uint8_t *mac, const mesh_coded_frame &frame, size_t len) {
+  if (!_net_coding) return;
+
+  // koder ma obie wiadomości
+  const uint32_t now = millis();
+  _lockState();
+  _coder.onHeard(mac, frame.mid_a, now);
+  _coder.onHeard(mac, frame.mid_b, now);
+  // relay przekazał naszą wiadomość w parze XOR — to też echo
+  if (_adaptive_rate) {
+    if (_link.awaiting(frame.mid_a)) _link.onEcho(mac, frame.mid_a, now);
+    if (_link.awaiting(frame.mid_b)) _link.onEcho(mac, frame.mid_b, now);
+  }
+  _unlockState();
+
+  const bool seen_a = _seen(frame.mid_a);
+  const bool seen_b = _seen(frame.mid_b);
+  if (seen_a == seen_b) {
+    // obie znane: nic nowego; żadna: nie da się zdekodować
+    if (!seen_a) {
+      _lockState();
+      _coder.stats().undecodable++;
+      _unlockState();
+    }
+    return;
+  }
+
+  const uint32_t known   = seen_a ? frame.mid_a : frame.mid_b;
+  const uint32_t missing = seen_a ? frame.mid_b : frame.mid_a;
+  const int8_t   ttl     = seen_a ? frame.ttl_b : frame.ttl_a;
+
+  standard_mesh_message msg{};
+  _lockState();
+  const bool ok = _coder.decode(frame, len, known, reinterpret_cast<uint8_t*>(&msg));
+  if (ok) _coder.stats().decoded++;
+  else    _coder.stats().undecodable++; // znana, ale wypadła już z cache treści
+  _unlockState();
+  if (!ok) return;
+  msg.ttl = ttl;
+  msg.mid = missing;
+
+  FrameMeta meta{};
+  _topicMeta(msg.topic, meta);
+  meta.compact      = (frame.flags & (seen_a ? MESH_NC_B_COMPACT : MESH_NC_A_COMPACT)) != 0;
+  meta.topic_inline = (frame.flags & (seen_a ? MESH_NC_B_INLINE  : MESH_NC_A_INLINE))  != 0;
+  meta.compressed   = (frame.flags & (seen_a ? MESH_NC_B_COMPRESSED : MESH_NC_A_COMPRESSED)) != 0;
+  // body niesie samo ID ("#xxxx") — nazwa z lokalnej tablicy, jak w _decodeCompact
+  if (meta.compact && !meta.topic_inline) {
+    const char *name = _topicName(meta.topic_id);
+    if (name) {
+      memset(msg.topic, 0, sizeof(msg.topic));
+      strncpy(msg.topic, name, sizeof(msg.topic) - 1);
+    }
+  }
+  _processMessage(mac, msg, meta);
+}
+
+// Treść do XOR musi mieć u wszystkich węzłów te same bajty. Stary format
+// niesie je wprost w ramce; z ramki kompaktowej każdy węzeł odtwarza
+// wiadomość sam (nazwa topicu tylko, jeśli ją zna), więc kodujemy postać
+// z ramki: topic bez nazwy jako "#xxxx", nadawca z MAC-a, zera po stringach.
+void MeshLib::_codedBody(const standard_mesh_message &msg, const FrameMeta &meta,
+                         standard_mesh_message &out) const {
+  if (!meta.compact) {
+    out = msg;
+    return;
+  }
+  memset(&out, 0, sizeof(out));
+  if (_equals(msg.type, MESH_TYPE_CMD))         strncpy(out.type, MESH_TYPE_CMD,    sizeof(out.type) - 1);
+  else if (_equals(msg.type, MESH_TYPE_RETAIN)) strncpy(out.type, MESH_TYPE_RETAIN, sizeof(out.type) - 1);
+  else if (_equals(msg.type, MESH_TYPE_RETAIN_REPLAY)) {
+    strncpy(out.type, MESH_TYPE_RETAIN_REPLAY, sizeof(out.type) - 1);
+  }
+  else                                          strncpy(out.type, MESH_TYPE_DATA,   sizeof(out.type) - 1);
+  if (meta.topic_inline) {
+    strncpy(out.topic, msg.topic, sizeof(out.topic) - 1);
+  } else {
+    snprintf(out.topic, sizeof(out.topic), "#%04x", meta.topic_id);
+  }
+  strncpy(out.payload, msg.payload, sizeof(out.payload) - 1);
+  uint8_t mac[6] = {0};
+  (void)meshParseMac(msg.sender, mac);
+  snprintf(out.sender, sizeof(out.sender), "%02X:%02X:%02X:%02X:%02X:%02X",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  out.ttl = msg.ttl;
+  out.mid = msg.mid;
+}
+
+// ================== PRZYCINANIE FLOODU (SUBSKRYPCJE) ==================
+
+void MeshLib::setSubscriptionPruning(bool enabled) {
+  _lockState();
+  _sub_pruning = enabled;
+  _sf_changed = enabled;   // pierwsze ogłoszenie od razu
+  _unlockState();
+}
+
+void MeshLib::_stepSubAdvert() {
+  if (!_sub_pruning || !_espnow_active) return;
+
+  const unsigned long now = millis();
+  const unsigned long since = now - _sf_advert_time;
+  // zmiana filtra sąsiada: ogłoś wcześniej, ale nie częściej niż co sekundę
+  if (since < _sf_advert_gap && !(_sf_changed && since >= 1000)) return;
+
+  mesh_sub_advert adv;
+  _lockState();
+  const bool changed = _subfilter.buildAdvert(adv, now);
+  _sf_changed = false;
+  _unlockState();
+
+  // zmiana sąsiada bez zmiany naszych poziomów — czekamy na okres
+  if (!changed && since < _sf_advert_gap) return;
+
+  _sf_advert_time = now;
+  _sf_advert_gap = MESH_SF_ADVERT_MS - MESH_SF_ADVERT_MS / 8 + rand32() % (MESH_SF_ADVERT_MS / 4);
+  const int r = _sendRaw(BROADCAST_ADDR, reinterpret_cast<const uint8_t*>(&adv), MESH_SF_ADVERT_LEN);
+  if (r == 0) {
+    _lockState();
+    _subfilter.stats().adverts_sent++;
+    _unlockState();
+  }
+}
+
+// ================== SZKIELET RELAYÓW (MPR) ==================
+
+void MeshLib::setBackbone(bool enabled) {
+  _lockState();
+  _backbone_on = enabled;
+  _bb_changed = enabled;   // pierwsze hello od razu
+  _unlockState();
+}
+
+void MeshLib::_stepHello() {
+  // węzeł śpiący nie ogłasza się, więc nikt nie wybierze go na relay
+  if (!_backbone_on || !_espnow_active || _dc.role() == MESH_DC_SLEEPY) return;
+
+  const unsigned long now = millis();
+  const unsigned long since = now - _bb_hello_time;
+  if (since < _bb_hello_gap && !(_bb_changed && since >= 1000)) return;
+
+  // wybór MPR na kopii tablicy, poza sekcją krytyczną (spinlock / wyłączone
+  // przerwania); hello budowane z aktualnej tablicy
+  _lockState();
+  _backbone.beginSelect();
+  _bb_changed = false;
+  _unlockState();
+  _backbone.select(now);
+
+  mesh_hello hello;
+  _lockState();
+  const size_t len = _backbone.finishHello(hello, now);
+  _unlockState();
+
+  _bb_hello_time = now;
+  _bb_hello_gap = MESH_BB_HELLO_MS - MESH_BB_HELLO_MS / 8 + rand32() % (MESH_BB_HELLO_MS / 4);
+  if (_sendRaw(BROADCAST_ADDR, reinterpret_cast<const uint8_t*>(&hello), len) == 0) {
+    _lockState();
+    _backbone.stats().hellos_sent++;
+    _unlockState();
+  }
+}
+
+// ================== SKOORDYNOWANY SEN ==================
+
+void MeshLib::setSleepy(uint32_t period_ms, uint16_t window_ms) {
+  const int n = _topics_count < MESH_MAX_SUBSCRIPTIONS ? _topics_count : MESH_MAX_SUBSCRIPTIONS;
+  _lockState();
+  _dc.setSchedule(period_ms, window_ms);
+  _dc.setTopics(_sub_ids, size_t(n), _topics_count == 0 || _topics_count > MESH_MAX_SUBSCRIPTIONS);
+  _dc.setRole(period_ms ? MESH_DC_SLEEPY : MESH_DC_OFF, millis());
+  _unlockState();
+  if (!period_ms) _radioWake(); // powrót do stałego nasłuchu
+}
+
+void MeshLib::setSleepParent(bool enabled) {
+  _lockState();
+  _dc.setRole(enabled ? MESH_DC_PARENT : MESH_DC_OFF, millis());
+  _unlockState();
+}
+
+void MeshLib::_offerSleepy(const standard_mesh_message &msg, const FrameMeta &meta) {
+  if (_dc.childCount() == 0) return;
+
+  // komenda z MAC celu trafia tylko do tego dziecka, reszta według subskrypcji
+  uint8_t target[6];
+  bool has_target = false;
+  if (_equals(msg.type, MESH_TYPE_CMD) &&
+      (_topicIs(meta, msg, MESH_TID_OTA_START) || _topicIs(meta, msg, MESH_TID_REBOOT))) {
+    char target_mac[18];
+    has_target = _parseTargetMac(msg.payload, target_mac, sizeof(target_mac)) &&
+                 meshParseMac(target_mac, target);
+  }
+
+  uint8_t source[6];
+  const bool has_source = meshParseMac(msg.sender, source);
+
+  // Seria idzie broadcastem, więc słyszą ją też inne węzły, które mogły już
+  // zapomnieć MID — kopia z TTL 1 (ten sam MID) nie rozejdzie się ponownie.
+  // Dziecko i tak nie forwarduje, pierwotny TTL nie jest mu potrzebny.
+  standard_mesh_message copy = msg;
+  copy.ttl = 1;
+  uint8_t frame[MESH_DC_FRAME_MAX];
+  const size_t len = _encodeFrame(copy, meta, frame);
+  _lockState();
+  (void)_dc.offer(frame, len, meta.topic_id, has_target ? target : nullptr,
+                  has_source ? source : nullptr, millis());
+  _unlockState();
+}
+
+void MeshLib::_stepDutyCycle() {
+  const MeshDcRole role = _dc.role();
+  if (role == MESH_DC_OFF || _ota_state != MESH_OTA_IDLE) return;
+  const unsigned long now = millis();
+
+  _lockState();
+  const MeshDcAction act = _dc.step(now);
+  _unlockState();
+
+  if (act == MESH_DC_WAKE) {
+    _radioWake();
+    mesh_dc_frame wake;
+    _lockState();
+    _dc.buildWake(wake);
+    _unlockState();
+    (void)_sendRaw(BROADCAST_ADDR, reinterpret_cast<const uint8_t*>(&wake), sizeof(wake));
+  } else if (act == MESH_DC_SLEEP) {
+    _radioSleep();
+  }
+
+  // rodzic: jedna ramka serii na wywołanie, z odstępem na nadanie poprzedniej
+  if (role != MESH_DC_PARENT || !_espnow_active || now - _dc_burst_time < MESH_DC_FRAME_MS / 2) return;
+  uint8_t frame[MESH_DC_FRAME_MAX];
+  _lockState();
+  const size_t len = _dc.nextBurst(now, frame);
+  _unlockState();
+  if (!len) return;
+
+  _dc_burst_time = now;
+  const int r = _sendRaw(BROADCAST_ADDR, frame, len);
+  if (r != 0) {
+    MESH_LOG("⚠️ sleepy burst send failed: err=%d\n", r);
+  }
+}
+
+void MeshLib::_radioSleep() {
+  _stopEspNow();
+#if defined(ARDUINO_ARCH_ESP32)
+  esp_wifi_stop();
+#elif defined(ARDUINO_ARCH_ESP8266)
+  WiFi.mode(WIFI_OFF);
+  WiFi.forceSleepBegin();
+#endif
+}
+
+void MeshLib::_radioWake() {
+  if (_espnow_active) return;
+#if defined(ARDUINO_ARCH_ESP32)
+  esp_wifi_start();
+#elif defined(ARDUINO_ARCH_ESP8266)
+  WiFi.forceSleepWake();
+#endif
+  _configureRadio();
+  if (!_startEspNow()) {
+    MESH_LOG("⚠️ radio wake failed\n");
+  }
+}
+
+// ================== LIMITER FORWARDÓW ==================
+
+bool MeshLib::_admitForward(const uint8_t *mac, const standard_mesh_message &msg, const FrameMeta &meta) {
+  // origin = pierwotny nadawca; gdy sender nieczytelny, liczymy na sąsiada
+  uint8_t origin[6];
+  if (!meshParseMac(msg.sender, origin)) {
+    memcpy(origin, mac, 6);
+  }
+  const MeshPriority prio = _equals(msg.type, MESH_TYPE_CMD) ? MESH_PRIO_CONTROL : MESH_PRIO_DATA;
+  const uint32_t airtime = MeshRateLimiter::airtimeUs(_frameLen(msg, meta), _txKbps());
+
+  _lockState();
+  const MeshForwardVerdict v = _limiter.admit(origin, prio, airtime, millis());
+  _unlockState();
+
+  if (v != MESH_FWD_OK) {
+#if MESH_LIB_LOG_ENABLED
+    MESH_LOG("🚫 forward shed (%s): mid=%lu sender=%s topic=%s\n",
+             v == MESH_FWD_SHED_RATE ? "rate" : "airtime",
+             (unsigned long)msg.mid, msg.sender, msg.topic);
+#endif
+    return false;
+  }
+  return true;
+}
+
+void MeshLib::setForwardLimit(MeshPriority prio, uint16_t rate, uint16_t burst) {
+  _lockState();
+  _limiter.setLimit(prio, rate, burst);
+  _unlockState();
+}
+
+void MeshLib::setAirtimeBudget(uint16_t permille, uint16_t data_reserve_permille) {
+  _lockState();
+  _limiter.setAirtimeBudget(permille, data_reserve_permille);
+  _unlockState();
+}
+
+void MeshLib::setRateLimitEnabled(bool enabled) {
+  _lockState();
+  _limiter.setEnabled(enabled);
+  _unlockState();
+}
+
+// ================== ADAPTACYJNY RATE ==================
+
+#if defined(ARDUINO_ARCH_ESP32)
+static wifi_phy_rate_t toWifiPhyRate(MeshPhyRate rate) {
+  static const wifi_phy_rate_t MAP[MESH_PHY_COUNT] = {
+    WIFI_PHY_RATE_LORA_250K, WIFI_PHY_RATE_LORA_500K,
+    WIFI_PHY_RATE_1M_L, WIFI_PHY_RATE_2M_L, WIFI_PHY_RATE_5M_L,
+    WIFI_PHY_RATE_6M, WIFI_PHY_RATE_9M, WIFI_PHY_RATE_11M_L,
+    WIFI_PHY_RATE_12M, WIFI_PHY_RATE_18M, WIFI_PHY_RATE_24M,
+    WIFI_PHY_RATE_36M, WIFI_PHY_RATE_48M, WIFI_PHY_RATE_54M
+  };
+  return (rate < MESH_PHY_COUNT) ? MAP[rate] : WIFI_PHY_RATE_1M_L;
+}
+#endif
+
+bool MeshLib::setAdaptiveRate(bool enabled) {
+#if defined(ARDUINO_ARCH_ESP32)
+  _adaptive_rate = enabled;
+  if (_espnow_active && _ota_state == MESH_OTA_IDLE) {
+    _configureRadio(); // protokół 11g + RSSI; przy wyłączeniu powrót do 11B|LR
+  }
+  return true;
+#else
+  (void)enabled;
+  MESH_LOG("⚠️ adaptive rate not supported on ESP8266\n");
+  return false;
+#endif
+}
+
+void MeshLib::setLinkConfig(const mesh_link_config &cfg) {
+  _lockState();
+  _link.setConfig(cfg);
+  _unlockState();
+}
+
+// Rate, z jakim poleci następna ramka — ten sam wybór co w _applyTxRate(),
+// nie ostatnio ustawiony w sterowniku
+uint32_t MeshLib::_txKbps() {
+  if (!_adaptive_rate) return MESH_AIRTIME_RATE_KBPS;
+  _lockState();
+  const mesh_link_choice c = _link.selectBroadcast(millis());
+  _unlockState();
+  return c.kbps;
+}
+
+void MeshLib::_applyTxRate() {
+#if defined(ARDUINO_ARCH_ESP32)
+  if (!_adaptive_rate) return;
+
+  // Wołane z loop() i z callbacku odbioru: wybór i rezerwacja zmiany pod
+  // blokadą, wywołania sterownika poza nią (nie w sekcji krytycznej)
+  _lockState();
+  const mesh_link_choice c = _link.selectBroadcast(millis());
+  const bool set_rate = (c.rate != _cur_rate);
+  const bool set_power = (c.power_q != _cur_power_q);
+  if (set_rate) _cur_rate = c.rate;
+  if (set_power) _cur_power_q = c.power_q;
+  _unlockState();
+
+  // rate ESP-NOW jest globalny w sterowniku — zmieniamy tylko przy różnicy;
+  // przy błędzie stan "nieznany", następna ramka spróbuje ponownie
+  if (set_rate && esp_wifi_config_espnow_rate(WIFI_IF_STA, toWifiPhyRate(c.rate)) != ESP_OK) {
+    _lockState();
+    _cur_rate = MESH_PHY_COUNT;
+    _unlockState();
+  }
+  if (set_power && esp_wifi_set_max_tx_power(c.power_q) != ESP_OK) {
+    _lockState();
+    _cur_power_q = 0;
+    _unlockState();
   }
+#endif
+}
+
+void MeshLib::_stepLinkRate() {
+  if (!_adaptive_rate) return;
+  _lockState();
+  _link.expire(millis());
+  _unlockState();
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+void MeshLib::_promiscThunk(void *buf, wifi_promiscuous_pkt_type_t type) {
+  if (type != WIFI_PKT_MGMT || !buf || !_instance) return;
+  const wifi_promiscuous_pkt_t *pkt = static_cast<const wifi_promiscuous_pkt_t*>(buf);
+  if (pkt->rx_ctrl.sig_len < 28) return;
+
+  // ESP-NOW = action frame (0xD0), kategoria vendor-specific (127), OUI Espressif
+  const uint8_t *f = pkt->payload;
+  if (f[0] != 0xD0 || f[24] != 127 || f[25] != 0x18 || f[26] != 0xFE || f[27] != 0x34) return;
+
+  _instance->_lockState();
+  _instance->_link.onRssi(f + 10, (int8_t)pkt->rx_ctrl.rssi, millis()); // addr2 = nadawca
+  _instance->_unlockState();
 }
+#endif
 
 // ================== AUTO CMD (DISCOVER) ==================
 
-void MeshLib::_autoHandleCmd(standard_mesh_message &msg) {
-  if (_equals(msg.topic, MESH_TOPIC_DISCOVER_GET)) {
-    _sendDiscoverPost();
-  } else if (_equals(msg.topic, MESH_TOPIC_OTA_START)) {
-    _handleOTARequest(msg);
-  } else if (_equals(msg.topic, MESH_TOPIC_REBOOT)) {
-    _handleRebootRequest(msg);
+void MeshLib::_autoHandleCmd(const uint8_t *mac, standard_mesh_message &msg, const FrameMeta &meta) {
+  // topic dynamiczny z ramki mógłby mieć to samo ID co wbudowany
+  if (meta.topic_inline && !_equals(msg.topic, _topicName(meta.topic_id))) return;
+
+  switch (meta.topic_id) {
+    case MESH_TID_DISCOVER_GET: _sendDiscoverPost();          break;
+    case MESH_TID_OTA_START:    _handleOTARequest(msg);       break;
+    case MESH_TID_REBOOT:       _handleRebootRequest(msg);    break;
+    case MESH_TID_RETAIN_GET:   _handleRetainRequest(msg);    break;
+    case MESH_TID_AGG_QUERY:    _handleAggQuery(mac, msg);    break;
+    default: break;
   }
 }
 
@@ -329,6 +1126,272 @@ void MeshLib::_sendDiscoverPost() {
   (void)_sendMessage(resp);
 }
 
+static bool extractField(const char *payload, const char *key, char *out, size_t out_size);
+
+// ================== RETAINED ==================
+
+void MeshLib::setRetainCache(bool enabled) {
+  _lockState();
+  _retain_cache = enabled;
+  if (!enabled) {
+    _retain.clear();
+    _retain_reply.active = false;
+  }
+  _unlockState();
+}
+
+// replay = odpowiedź innego cache: może być starsza niż nasza wartość,
+// więc tylko uzupełnia brakujący topic (np. cache po restarcie)
+void MeshLib::_onRetained(const standard_mesh_message &msg, bool replay) {
+  if (!_retain_cache) return;
+  uint8_t publisher[6] = {0};
+  (void)meshParseMac(msg.sender, publisher);
+  _lockState();
+  if (!replay || (msg.payload[0] != '\0' && !_retain.contains(msg.topic))) {
+    (void)_retain.put(msg.topic, msg.payload, publisher);
+  }
+  _unlockState();
+}
+
+void MeshLib::_handleRetainRequest(const standard_mesh_message &msg) {
+  if (!_retain_cache || _retain.count() == 0) return;
+
+  // odległość w hopach = TTL startowe - TTL przy odbiorze + 1
+  char field[MESH_RETAIN_TOPIC_MAX];
+  int ttl0 = MESH_DEFAULT_TTL;
+  if (extractField(msg.payload, "ttl0=", field, sizeof(field))) ttl0 = atoi(field);
+  int hops = ttl0 - msg.ttl + 1;
+  if (hops < 1) hops = 1;
+  if (hops > MESH_DEFAULT_TTL) hops = MESH_DEFAULT_TTL;
+
+  if (!extractField(msg.payload, "topic=", field, sizeof(field))) field[0] = '\0';
+
+  _lockState();
+  if (_retain_reply.active && strcmp(_retain_reply.filter, field) == 0) {
+    if (hops > _retain_reply.ttl) _retain_reply.ttl = hops;
+  } else {
+    _retain_reply.ttl = hops;
+    strncpy(_retain_reply.filter, field, sizeof(_retain_reply.filter) - 1);
+    _retain_reply.filter[sizeof(_retain_reply.filter) - 1] = '\0';
+  }
+  // migawka po seq: wpisy zaktualizowane w trakcie nie przesuwają odtwarzania
+  _retain_reply.after = _retain.firstSeq() - 1;
+  _retain_reply.upto = _retain.lastSeq();
+  _retain_reply.started = false;
+  _retain_reply.next_ms = millis() + rand32() % (MESH_RETAIN_BACKOFF_MS + 1);
+  _retain_reply.active = true;
+  _unlockState();
+#if MESH_LIB_LOG_ENABLED
+  MESH_LOG("📌 retain/get from %s (hops=%d, topic=%s)\n",
+           msg.sender, hops, field[0] ? field : "*");
+#endif
+}
+
+bool MeshLib::requestRetained(const char *topic) {
+  _retain_filter[0] = '\0';
+  if (topic) strncpy(_retain_filter, topic, sizeof(_retain_filter) - 1);
+  _retain_answered = false;
+  _retain_ring = 1;
+  return _sendRetainGet();
+}
+
+bool MeshLib::_sendRetainGet() {
+  char payload[sizeof(standard_mesh_message::payload)];
+  if (_retain_filter[0]) {
+    snprintf(payload, sizeof(payload), "ttl0=%u;topic=%s", _retain_ring, _retain_filter);
+  } else {
+    snprintf(payload, sizeof(payload), "ttl0=%u", _retain_ring);
+  }
+  _retain_ring_time = millis();
+  return sendCmd(MESH_TOPIC_RETAIN_GET, payload, _retain_ring);
+}
+
+void MeshLib::_stepRetain() {
+  const unsigned long now = millis();
+
+  // zapytujący: pierścień bez odpowiedzi → o hop dalej
+  if (_retain_ring) {
+    if (_retain_answered) {
+      _retain_ring = 0;
+    } else if (now - _retain_ring_time > (unsigned long)MESH_RETAIN_WAIT_MS * _retain_ring) {
+      if (_retain_ring >= MESH_DEFAULT_TTL) {
+#if MESH_LIB_LOG_ENABLED
+        MESH_LOG("📌 no retain cache within %d hops\n", MESH_DEFAULT_TTL);
+#endif
+        _retain_ring = 0;
+      } else {
+        _retain_ring++;
+        (void)_sendRetainGet();
+      }
+    }
+  }
+
+  // cache: po back-offie jedna odpowiedź co MESH_RETAIN_REPLY_GAP_MS
+  if (!_retain_reply.active || long(now - _retain_reply.next_ms) < 0) return;
+
+  mesh_retained e;
+  uint32_t seq;
+  bool found = false;
+  int16_t ttl = 0;
+  _lockState();
+  // wpisy zapisane po migawce (upto) pomijamy — ich nowa wartość właśnie
+  // poszła floodem
+  while (_retain.next(_retain_reply.after, e, seq) && int32_t(seq - _retain_reply.upto) <= 0) {
+    _retain_reply.after = seq;
+    if (_retain_reply.filter[0] == '\0' || strcmp(_retain_reply.filter, e.topic) == 0) {
+      found = true;
+      break;
+    }
+  }
+  ttl = _retain_reply.ttl;
+  _retain_reply.started = true;
+  _retain_reply.next_ms = now + MESH_RETAIN_REPLY_GAP_MS;
+  if (!found) _retain_reply.active = false;
+  _unlockState();
+  if (!found) return;
+
+  standard_mesh_message m{};
+  m.ttl = ttl;
+  snprintf(m.sender, sizeof(m.sender), "%02X:%02X:%02X:%02X:%02X:%02X",
+           e.publisher[0], e.publisher[1], e.publisher[2],
+           e.publisher[3], e.publisher[4], e.publisher[5]);
+  strncpy(m.type,    MESH_TYPE_RETAIN_REPLAY, sizeof(m.type) - 1);
+  strncpy(m.topic,   e.topic,          sizeof(m.topic) - 1);
+  strncpy(m.payload, e.payload,        sizeof(m.payload) - 1);
+  (void)_sendMessage(m);
+}
+
+// ================== AGREGACJA W SIECI ==================
+
+bool MeshLib::registerAggregate(const char *name, AggregateValueFn fn) {
+  if (!name || !name[0] || !fn || strlen(name) >= MESH_AGG_NAME_MAX || strchr(name, ';')) return false;
+  for (int i = 0; i < _agg_fn_count; ++i) {
+    if (_equals(_agg_fns[i].name, name)) {
+      _agg_fns[i].fn = fn;
+      return true;
+    }
+  }
+  if (_agg_fn_count >= MESH_AGG_FUNCS) return false;
+  _agg_fns[_agg_fn_count].name = name;
+  _agg_fns[_agg_fn_count].fn = fn;
+  _agg_fn_count++;
+  return true;
+}
+
+bool MeshLib::_aggValue(const char *name, int32_t &value) const {
+  if (_equals(name, MESH_AGG_NODES)) {
+    value = 1;
+    return true;
+  }
+  for (int i = 0; i < _agg_fn_count; ++i) {
+    if (_equals(_agg_fns[i].name, name)) return _agg_fns[i].fn(value);
+  }
+  return false; // węzeł bez tego agregatu tylko przekazuje wyniki dzieci
+}
+
+uint32_t MeshLib::queryAggregate(const char *name, int ttl) {
+  if (!name || !name[0] || strlen(name) >= MESH_AGG_NAME_MAX || strchr(name, ';')) return 0;
+  int depth = ttl <= 0 ? MESH_DEFAULT_TTL : ttl;
+  if (depth > 255) depth = 255;
+
+  uint32_t qid;
+  do {
+    qid = rand32();
+  } while (qid == 0);
+
+  _lockState();
+  const bool ok = _agg.start(qid, name, uint8_t(depth), MESH_AGG_SLOT_MS, millis());
+  _unlockState();
+  if (!ok) return 0;
+
+  char payload[sizeof(standard_mesh_message::payload)];
+  snprintf(payload, sizeof(payload), "q=%08lx;n=%s;d=%d;s=%u",
+           (unsigned long)qid, name, depth, (unsigned)MESH_AGG_SLOT_MS);
+  if (!sendCmd(MESH_TOPIC_AGG_QUERY, payload, depth)) {
+    MESH_LOG("⚠️ agg/query send failed: %s\n", name);
+  }
+  // nawet bez wysyłki sesja kończy się wynikiem (sam węzeł)
+  return qid;
+}
+
+void MeshLib::_handleAggQuery(const uint8_t *mac, const standard_mesh_message &msg) {
+  char field[MESH_AGG_NAME_MAX];
+  if (!extractField(msg.payload, "q=", field, sizeof(field))) return;
+  const uint32_t qid = uint32_t(strtoul(field, nullptr, 16));
+  if (!extractField(msg.payload, "d=", field, sizeof(field))) return;
+  const int max_depth = atoi(field);
+  unsigned slot = MESH_AGG_SLOT_MS;
+  if (extractField(msg.payload, "s=", field, sizeof(field))) slot = unsigned(atoi(field));
+  if (slot < 20 || slot > 5000) slot = MESH_AGG_SLOT_MS;
+  char name[MESH_AGG_NAME_MAX];
+  if (!extractField(msg.payload, "n=", name, sizeof(name))) return;
+
+  // głębokość w drzewie = TTL startowe - TTL przy odbiorze + 1; rodzic = nadawca kopii
+  const int depth = max_depth - msg.ttl + 1;
+  if (max_depth < 1 || max_depth > 255 || depth < 1 || depth > max_depth) return;
+
+  _lockState();
+  const bool ok = _agg.onQuery(qid, name, mac, uint8_t(depth), uint8_t(max_depth),
+                               uint16_t(slot), millis(), rand32() % (slot / 2));
+  _unlockState();
+#if MESH_LIB_LOG_ENABLED
+  if (ok) {
+    MESH_LOG("Σ agg/query %s from %s (depth %d/%d)\n", name, msg.sender, depth, max_depth);
+  }
+#else
+  (void)ok;
+#endif
+}
+
+void MeshLib::_handleAggReply(const mesh_agg_reply &reply) {
+  // broadcast do wszystkich sąsiadów, scala tylko wskazany rodzic
+  uint8_t my[6];
+  _selfMac(my);
+  if (memcmp(reply.parent, my, 6) != 0) return;
+
+  mesh_agg_value v;
+  MeshAggregator::fromReply(reply, v);
+  _lockState();
+  (void)_agg.onReply(reply.qid, v, millis());
+  _unlockState();
+}
+
+void MeshLib::_stepAggregate() {
+  bool origin = false;
+  uint8_t parent[6];
+  mesh_agg_result result;
+
+  for (;;) {
+    _lockState();
+    const bool ready = _agg.due(millis(), origin, parent, result);
+    _unlockState();
+    if (!ready) return;
+
+    int32_t own = 0;
+    if (_aggValue(result.name, own)) MeshAggregator::add(result.value, own);
+
+    if (origin) {
+#if MESH_LIB_LOG_ENABLED
+      MESH_LOG("Σ agg %s: count=%lu min=%ld max=%ld sum=%lld\n", result.name,
+               (unsigned long)result.value.count, (long)result.value.min,
+               (long)result.value.max, (long long)result.value.sum);
+#endif
+      if (_agg_callback) _agg_callback(result);
+      continue;
+    }
+
+    // puste poddrzewo nic nie wnosi — oszczędzamy airtime
+    if (result.value.count == 0 || !_espnow_active) continue;
+    mesh_agg_reply reply;
+    MeshAggregator::toReply(result, parent, reply);
+    if (_sendRaw(BROADCAST_ADDR, reinterpret_cast<const uint8_t*>(&reply), sizeof(reply)) == 0) {
+      _lockState();
+      _agg.stats().replies_sent++;
+      _unlockState();
+    }
+  }
+}
+
 static bool extractField(const char *payload, const char *key, char *out, size_t out_size) {
   if (!payload || !key || !out || out_size == 0) return false;
 
@@ -390,24 +1453,171 @@ void MeshLib::_handleOTARequest(const standard_mesh_message &msg) {
 #endif
 }
 
+// ================== OTA DELTA ==================
+
+#if MESH_OTA_DELTA
+// Bieżący obraz: partycja, z której działa firmware
+class RunningImageSource : public MeshDeltaSource {
+public:
+  uint32_t size() const override {
+#if defined(ARDUINO_ARCH_ESP32)
+    const esp_partition_t *p = esp_ota_get_running_partition();
+    return p ? p->size : 0;
+#else
+    return ESP.getSketchSize();
+#endif
+  }
+
+  bool read(uint32_t offset, uint8_t *buf, size_t len) override {
+#if defined(ARDUINO_ARCH_ESP32)
+    const esp_partition_t *p = esp_ota_get_running_partition();
+    return p && esp_partition_read(p, offset, buf, len) == ESP_OK;
+#else
+    return ESP.flashRead(offset, buf, len); // szkic zaczyna się od 0x0
+#endif
+  }
+};
+
+// Partycja OTA przez Update. Ostatni bajt czeka na weryfikację hash —
+// niepełnego obrazu Update.end() nie aktywuje, więc porzucenie jest bezpieczne.
+class UpdateSink : public MeshDeltaSink {
+public:
+  bool begin(uint32_t size) override {
+    _size = size;
+    _done = 0;
+    _held = false;
+    return size > 0 && Update.begin(size);
+  }
+
+  bool write(const uint8_t *buf, size_t len) override {
+    size_t n = len;
+    if (_done + len == _size) {
+      _last = buf[len - 1];
+      _held = true;
+      --n;
+    }
+    _done += len;
+    return n == 0 || Update.write(const_cast<uint8_t*>(buf), n) == n;
+  }
+
+  bool end(bool commit) override {
+    if (commit && _held) {
+      uint8_t last = _last;
+      return Update.write(&last, 1) == 1 && Update.end();
+    }
+    Update.end(); // niepełny obraz → przerwanie aktualizacji
+    return !commit;
+  }
+
+private:
+  uint32_t _size = 0;
+  uint32_t _done = 0;
+  uint8_t _last = 0;
+  bool _held = false;
+};
+
+static RunningImageSource s_delta_src;
+static UpdateSink s_delta_sink;
+static WiFiServer s_delta_server(MESH_OTA_DELTA_PORT);
+static WiFiClient s_delta_client;
+
+void MeshLib::_stepDelta() {
+  if (!_delta_active) {
+    if (_ota_state != MESH_OTA_READY) return; // np. trwa upload ArduinoOTA
+    WiFiClient client = s_delta_server.available();
+    if (!client) return;
+    s_delta_client = client;
+    _delta.begin(s_delta_src, s_delta_sink);
+    _delta_active = true;
+    _ota_progress = 0;
+#if MESH_LIB_LOG_ENABLED
+    MESH_LOG("⬆️ OTA delta start\n");
+#endif
+    _otaSetState(MESH_OTA_UPDATING);
+  }
+
+  // ograniczony krok: loop() i mesh mają dalej działać
+  uint8_t buf[MESH_DELTA_BUF];
+  MeshDeltaResult r = MESH_DELTA_MORE;
+  for (int i = 0; i < 8 && r == MESH_DELTA_MORE; ++i) {
+    const size_t want = _delta.wants();
+    if (want == 0) {
+      r = _delta.poll(); // sprawdzanie bazy / kopie z bieżącej partycji
+      continue;
+    }
+    const int avail = s_delta_client.available();
+    if (avail <= 0) {
+      if (!s_delta_client.connected()) {
+        _delta.abort();
+        r = MESH_DELTA_ERR_FORMAT; // łatka urwana
+      }
+      break;
+    }
+    size_t n = (want < sizeof(buf)) ? want : sizeof(buf);
+    if (n > size_t(avail)) n = size_t(avail);
+    const int got = s_delta_client.read(buf, n);
+    if (got <= 0) break;
+    _ota_activity_time = millis();
+    r = _delta.feed(buf, size_t(got));
+  }
+
+  if (_delta.total() > 0) {
+    const uint8_t pct = uint8_t((uint64_t(_delta.written()) * 100U) / _delta.total());
+    if (pct != _ota_progress) {
+      _ota_progress = pct;
+      _otaNotify();
+    }
+  }
+  if (r != MESH_DELTA_MORE) _deltaEnd(r);
+}
+
+void MeshLib::_deltaEnd(MeshDeltaResult result) {
+  s_delta_client.printf("%s\n", MeshDeltaApplier::resultName(result));
+  s_delta_client.stop();
+  _delta_active = false;
+  _delta_result = result;
+
+  if (result == MESH_DELTA_OK) {
+#if MESH_LIB_LOG_ENABLED
+    MESH_LOG("✅ OTA delta applied and verified, reboot scheduled\n");
+#endif
+    _ota_result = MESH_OTA_RESULT_OK;
+    _otaSetState(MESH_OTA_DONE);
+    _lockState();
+    _reboot_pending = true;
+    _unlockState();
+    return;
+  }
+
+  // fallback: ArduinoOTA dalej nasłuchuje na pełny obraz
+#if MESH_LIB_LOG_ENABLED
+  MESH_LOG("❌ OTA delta failed (%s), waiting for full image\n",
+           MeshDeltaApplier::resultName(result));
+#endif
+  _ota_progress = 0;
+  _otaSetState(MESH_OTA_READY);
+}
+#endif
+
 void MeshLib::_enterOTAMode(const char *ssid, const char *passwd, const char *ip) {
-  if (_ota_mode) return;
+  if (_ota_state != MESH_OTA_IDLE) return;
 
 #if MESH_LIB_LOG_ENABLED
   MESH_LOG("🚀 Entering OTA mode...\n");
 #endif
 
 #if defined(ARDUINO_ARCH_ESP32)
-  esp_now_deinit();
+  // ESP-NOW zostaje; o jego dalszym losie decyduje kanał AP po połączeniu
   esp_wifi_set_ps(WIFI_PS_NONE);
+  esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G |
+                                     WIFI_PROTOCOL_11N | WIFI_PROTOCOL_LR);
 #else
-  esp_now_deinit();
+  _stopEspNow();
   WiFi.setSleepMode(WIFI_NONE_SLEEP);
 #endif
 
   WiFi.mode(WIFI_STA);
-  WiFi.disconnect(true);
-  delay(50);
+  WiFi.setAutoReconnect(false);
 
   if (ip && ip[0]) {
     IPAddress static_ip;
@@ -420,82 +1630,192 @@ void MeshLib::_enterOTAMode(const char *ssid, const char *passwd, const char *ip
   }
 
   WiFi.begin(ssid ? ssid : "", passwd ? passwd : "");
-  for (int i = 0; i < 50 && WiFi.status() != WL_CONNECTED; ++i) {
-    delay(300);
-  }
+  _ota_progress = 0;
+  _ota_upload_error = 0;
+  _otaSetState(MESH_OTA_CONNECTING);
+}
 
-  if (WiFi.status() != WL_CONNECTED) {
+void MeshLib::_otaConnected() {
+#if defined(ARDUINO_ARCH_ESP32)
+  const uint8_t ap_channel = (uint8_t)WiFi.channel();
+  if (ap_channel != _channel) {
 #if MESH_LIB_LOG_ENABLED
-    MESH_LOG("❌ OTA WiFi connect failed, restarting...\n");
+    MESH_LOG("📴 AP on ch=%u (mesh ch=%u), ESP-NOW paused for OTA\n", ap_channel, _channel);
 #endif
-    _exitOTAMode();
-    return;
+    _stopEspNow();
   }
+#endif
 
-  ArduinoOTA.setHostname(_name ? _name : "mesh-node");
-  ArduinoOTA.onStart([]() {
+  if (!_ota_begun) {
+    ArduinoOTA.setHostname(_name ? _name : "mesh-node");
+    ArduinoOTA.onStart([]() {
 #if MESH_LIB_LOG_ENABLED
-    MESH_LOG("⬆️ OTA start\n");
+      MESH_LOG("⬆️ OTA start\n");
 #endif
-    if (MeshLib::_instance) MeshLib::_instance->_ota_start_time = millis();
-  });
-  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-    if (MeshLib::_instance) MeshLib::_instance->_ota_start_time = millis();
+      if (MeshLib::_instance) MeshLib::_instance->_otaSetState(MESH_OTA_UPDATING);
+    });
+    ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+      MeshLib *self = MeshLib::_instance;
+      if (!self) return;
+      self->_ota_activity_time = millis();
+      const uint8_t pct = (total == 0) ? 0 : uint8_t((uint64_t(progress) * 100U) / total);
+      if (pct != self->_ota_progress) {
+        self->_ota_progress = pct;
 #if MESH_LIB_LOG_ENABLED
-    const unsigned int pct = (total == 0) ? 0 : (progress * 100U) / total;
-    MESH_LOG("⬆️ OTA progress: %u%%\r", pct);
+        MESH_LOG("⬆️ OTA progress: %u%%\r", (unsigned int)pct);
 #endif
-  });
-  ArduinoOTA.onEnd([]() {
+        self->_otaNotify();
+      }
+    });
+    ArduinoOTA.onEnd([]() {
 #if MESH_LIB_LOG_ENABLED
-    MESH_LOG("\n✅ OTA complete, reboot scheduled\n");
+      MESH_LOG("\n✅ OTA complete, reboot scheduled\n");
 #endif
-    if (MeshLib::_instance) {
-      MeshLib::_instance->_lockState();
-      MeshLib::_instance->_reboot_pending = true;
-      MeshLib::_instance->_unlockState();
-    }
-  });
-  ArduinoOTA.onError([](ota_error_t error) {
+      MeshLib *self = MeshLib::_instance;
+      if (!self) return;
+      self->_ota_result = MESH_OTA_RESULT_OK;
+      self->_otaSetState(MESH_OTA_DONE);
+      self->_lockState();
+      self->_reboot_pending = true;
+      self->_unlockState();
+    });
+    ArduinoOTA.onError([](ota_error_t error) {
 #if MESH_LIB_LOG_ENABLED
-    MESH_LOG("\n❌ OTA error: %u\n", (unsigned int)error);
+      MESH_LOG("\n❌ OTA error: %u\n", (unsigned int)error);
 #endif
-    if (MeshLib::_instance) MeshLib::_instance->_exitOTAMode();
-  });
+      MeshLib *self = MeshLib::_instance;
+      if (!self) return;
+      self->_ota_upload_error = (uint8_t)error;
+      self->_otaFail(MESH_OTA_RESULT_UPLOAD_ERROR); // sprzątanie w następnym kroku
+    });
+    _ota_begun = true;
+  }
   ArduinoOTA.begin();
+#if MESH_OTA_DELTA
+  s_delta_server.begin();
+#endif
 
-  _ota_mode = true;
-  _ota_start_time = millis();
+  _otaSetState(MESH_OTA_READY);
 
 #if MESH_LIB_LOG_ENABLED
-  MESH_LOG("✅ OTA ready at %s\n", WiFi.localIP().toString().c_str());
+  MESH_LOG("✅ OTA ready at %s (mesh %s)\n", WiFi.localIP().toString().c_str(),
+           _espnow_active ? "active" : "paused");
 #endif
 }
 
 void MeshLib::_handleOTA() {
-  if (!_ota_mode) return;
+  const unsigned long now = millis();
 
-  ArduinoOTA.handle();
+  switch (_ota_state) {
+    case MESH_OTA_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        _otaConnected();
+      } else if (now - _ota_state_time > MESH_OTA_CONNECT_TIMEOUT_MS) {
+#if MESH_LIB_LOG_ENABLED
+        MESH_LOG("❌ OTA WiFi connect failed\n");
+#endif
+        _otaFail(MESH_OTA_RESULT_WIFI_FAILED);
+      }
+      break;
 
-  if (millis() - _ota_start_time > OTA_TIMEOUT_MS) {
+    case MESH_OTA_READY:
+    case MESH_OTA_UPDATING:
+      ArduinoOTA.handle();
+#if MESH_OTA_DELTA
+      _stepDelta();
+#endif
+      if ((_ota_state == MESH_OTA_READY || _ota_state == MESH_OTA_UPDATING) &&
+          millis() - _ota_activity_time > MESH_OTA_TIMEOUT_MS) {
 #if MESH_LIB_LOG_ENABLED
-    MESH_LOG("⏰ OTA timeout, restarting...\n");
+        MESH_LOG("⏰ OTA timeout\n");
 #endif
-    _exitOTAMode();
+        _otaFail(MESH_OTA_RESULT_TIMEOUT);
+      }
+      break;
+
+    case MESH_OTA_FAILED:
+      _exitOTAMode();
+      break;
+
+    case MESH_OTA_IDLE:
+    case MESH_OTA_DONE:
+      break;
   }
 }
 
+void MeshLib::_otaSetState(MeshOtaState state) {
+  _ota_state = state;
+  _ota_state_time = millis();
+  _ota_activity_time = _ota_state_time;
+  _otaNotify();
+}
+
+void MeshLib::_otaFail(MeshOtaResult result) {
+  _ota_result = result;
+  _otaSetState(MESH_OTA_FAILED);
+}
+
+void MeshLib::_otaNotify() {
+  if (_ota_callback) _ota_callback(otaStatus());
+}
+
+mesh_ota_status MeshLib::otaStatus() const {
+  mesh_ota_status st{};
+  st.state        = _ota_state;
+  st.last_result  = _ota_result;
+  st.progress     = _ota_progress;
+  st.upload_error = _ota_upload_error;
+  st.mesh_active  = _espnow_active;
+  st.delta_result = _delta_result;
+  st.state_ms     = millis() - _ota_state_time;
+  return st;
+}
+
+bool MeshLib::cancelOTA() {
+  if (_ota_state == MESH_OTA_IDLE || _ota_state == MESH_OTA_DONE) return false;
+  _otaFail(MESH_OTA_RESULT_CANCELLED);
+  _exitOTAMode();
+  return true;
+}
+
 void MeshLib::_exitOTAMode() {
-  _ota_mode = false;
+  _lockState();
   _ota_pending = false;
+  _unlockState();
 
 #if MESH_LIB_LOG_ENABLED
-  MESH_LOG("↩️ Exiting OTA mode, rebooting to restore mesh...\n");
+  MESH_LOG("↩️ Exiting OTA mode, restoring mesh...\n");
 #endif
 
-  delay(200);
-  ESP.restart();
+#if MESH_OTA_DELTA
+  if (_delta_active) {
+    _delta.abort();
+    s_delta_client.stop();
+    _delta_active = false;
+  }
+  s_delta_server.stop();
+#endif
+#if defined(ARDUINO_ARCH_ESP32)
+  if (_ota_begun) ArduinoOTA.end();
+  _ota_begun = false;
+#endif
+  // OTA na kanale mesh zostawia ESP-NOW włączone; disconnect(true) wyłącza
+  // pod nim radio, więc najpierw deinit — inaczej _startEspNow() nic nie zrobi
+  _stopEspNow();
+  WiFi.disconnect(true);
+  _configureRadio();
+  if (!_startEspNow()) {
+    // bez ESP-NOW węzeł jest bezużyteczny — restart jako ostatnia deska ratunku
+    delay(200);
+    ESP.restart();
+  }
+
+  _otaSetState(MESH_OTA_IDLE);
+#if MESH_LIB_LOG_ENABLED
+  MESH_LOG("✅ Mesh restored (ch=%u)\n", _channel);
+#endif
 }
+
 void MeshLib::_handleRebootRequest(const standard_mesh_message &msg) {
   char target_mac[18];
   if (_parseTargetMac(msg.payload, target_mac, sizeof(target_mac)) && _isForUs(target_mac)) {
@@ -516,6 +1836,177 @@ void MeshLib::_doReboot() {
   ESP.restart();
 }
 
+// ================== ID TOPICÓW / RAMKI KOMPAKTOWE ==================
+
+bool MeshLib::registerTopic(const char *topic) {
+  if (!topic || topic[0] == '\0') return false;
+  uint16_t id;
+  if (_rawTopicId(topic, id)) {
+    MESH_LOG("⚠️ topic %s is a reserved raw ID, not registered\n", topic);
+    return false;
+  }
+  id = meshTopicId(topic);
+  for (int i = 0; i < _topic_table_count; ++i) {
+    if (_topic_table[i].id != id) continue;
+    if (strcmp(_topic_table[i].name, topic) == 0) return true;
+    MESH_LOG("⚠️ topic ID collision: %s vs %s (0x%04x), sent inline\n",
+             topic, _topic_table[i].name, id);
+    return false;
+  }
+  if (_topic_table_count >= MESH_TOPIC_TABLE_MAX) return false;
+  _topic_table[_topic_table_count].id = id;
+  _topic_table[_topic_table_count].name = topic;
+  _topic_table_count++;
+  return true;
+}
+
+const char *MeshLib::_topicName(uint16_t id) const {
+  for (int i = 0; i < _topic_table_count; ++i) {
+    if (_topic_table[i].id == id) return _topic_table[i].name;
+  }
+  return nullptr;
+}
+
+bool MeshLib::_topicIs(const FrameMeta &meta, const standard_mesh_message &msg, uint16_t id) const {
+  return meta.topic_id == id && (!meta.topic_inline || _equals(msg.topic, _topicName(id)));
+}
+
+// "#" + 4 cyfry hex (tak _decodeCompact zapisuje nieznane ID) jest
+// zarezerwowane: taki topic zawsze oznacza surowe ID, nigdy nazwę
+bool MeshLib::_rawTopicId(const char *topic, uint16_t &id) {
+  if (!topic || topic[0] != '#' || strlen(topic) != 5) return false;
+  uint16_t v = 0;
+  for (int i = 1; i < 5; ++i) {
+    const int h = meshHexValue(topic[i]);
+    if (h < 0) return false;
+    v = uint16_t((v << 4) | h);
+  }
+  if (v == 0) return false; // 0 = brak ID
+  id = v;
+  return true;
+}
+
+void MeshLib::_topicMeta(const char *topic, FrameMeta &meta) const {
+  meta.compact = _compact_frames;
+  meta.compressed = _compress_payloads;
+
+  // "#xxxx" = ID bez znanej nazwy (z ramki kompaktowej) — wraca jako samo ID
+  if (_rawTopicId(topic, meta.topic_id)) {
+    meta.topic_inline = false;
+    return;
+  }
+
+  meta.topic_id = meshTopicId(topic);
+  const char *name = _topicName(meta.topic_id);
+  meta.topic_inline = !(name && strcmp(name, topic) == 0);
+}
+
+// Przy kompresji górne oszacowanie (bez kompresowania drugi raz)
+size_t MeshLib::_frameLen(const standard_mesh_message &msg, const FrameMeta &meta) const {
+  if (!meta.compact) return sizeof(msg);
+  size_t len = MESH_CF_HEADER_LEN + strnlen(msg.payload, sizeof(msg.payload) - 1);
+  if (meta.topic_inline) len += strnlen(msg.topic, sizeof(msg.topic) - 1) + 1;
+  return len;
+}
+
+size_t MeshLib::_encodeCompact(const standard_mesh_message &msg, const FrameMeta &meta,
+                               mesh_compact_frame &out) const {
+  uint8_t type;
+  if (_equals(msg.type, MESH_TYPE_DATA))        type = MESH_CF_TYPE_DATA;
+  else if (_equals(msg.type, MESH_TYPE_CMD))    type = MESH_CF_TYPE_CMD;
+  else if (_equals(msg.type, MESH_TYPE_RETAIN)) type = MESH_CF_TYPE_RETAIN;
+  else if (_equals(msg.type, MESH_TYPE_RETAIN_REPLAY)) type = MESH_CF_TYPE_REPLAY;
+  else return 0;
+
+  out.magic    = MESH_CF_MAGIC;
+  out.ttl      = int8_t(msg.ttl > 127 ? 127 : msg.ttl);
+  out.flags    = type | (meta.topic_inline ? MESH_CF_TOPIC_INLINE : 0);
+  out.mid      = msg.mid;
+  out.topic_id = meta.topic_id;
+  if (!meshParseMac(msg.sender, out.sender)) memset(out.sender, 0, 6);
+
+  size_t pos = 0;
+  if (meta.topic_inline) {
+    const size_t tlen = strnlen(msg.topic, sizeof(msg.topic) - 1);
+    memcpy(out.data, msg.topic, tlen);
+    out.data[tlen] = '\0';
+    pos = tlen + 1;
+  }
+  const size_t plen = strnlen(msg.payload, sizeof(msg.payload) - 1);
+  if (meta.compressed && plen >= MESH_COMPRESS_MIN_LEN) {
+    // limit plen - 1: skompresowany albo wcale
+    const size_t clen = MeshLz::compress(reinterpret_cast<const uint8_t*>(msg.payload), plen,
+                                         out.data + pos, plen - 1);
+    if (clen) {
+      out.flags |= MESH_CF_COMPRESSED;
+      out.payload_len = uint8_t(clen);
+      return MESH_CF_HEADER_LEN + pos + clen;
+    }
+  }
+  memcpy(out.data + pos, msg.payload, plen);
+  out.payload_len = uint8_t(plen);
+  return MESH_CF_HEADER_LEN + pos + plen;
+}
+
+bool MeshLib::_decodeCompact(const uint8_t *data, int len,
+                             standard_mesh_message &msg, FrameMeta &meta) const {
+  if (len < (int)MESH_CF_HEADER_LEN || len > (int)sizeof(mesh_compact_frame)) return false;
+  mesh_compact_frame f;
+  memcpy(&f, data, len);
+  if (f.magic != MESH_CF_MAGIC) return false;
+
+  const char *type;
+  switch (f.flags & MESH_CF_TYPE_MASK) {
+    case MESH_CF_TYPE_DATA:   type = MESH_TYPE_DATA;   break;
+    case MESH_CF_TYPE_CMD:    type = MESH_TYPE_CMD;    break;
+    case MESH_CF_TYPE_RETAIN: type = MESH_TYPE_RETAIN; break;
+    case MESH_CF_TYPE_REPLAY: type = MESH_TYPE_RETAIN_REPLAY; break;
+    default: return false;
+  }
+
+  const size_t data_len = size_t(len) - MESH_CF_HEADER_LEN;
+  size_t pos = 0;
+  meta.topic_id = f.topic_id;
+  meta.compact = true;
+  meta.topic_inline = (f.flags & MESH_CF_TOPIC_INLINE) != 0;
+  if (meta.topic_inline) {
+    const uint8_t *nul = static_cast<const uint8_t*>(memchr(f.data, 0, data_len));
+    if (!nul) return false;
+    const size_t tlen = size_t(nul - f.data);
+    if (tlen >= sizeof(msg.topic)) return false;
+    memcpy(msg.topic, f.data, tlen);
+    pos = tlen + 1;
+  } else {
+    const char *name = _topicName(f.topic_id);
+    if (name) {
+      strncpy(msg.topic, name, sizeof(msg.topic) - 1);
+    } else {
+      snprintf(msg.topic, sizeof(msg.topic), "#%04x", f.topic_id);
+    }
+  }
+
+  if (f.payload_len != data_len - pos) return false;
+  meta.compressed = (f.flags & MESH_CF_COMPRESSED) != 0;
+  if (meta.compressed) {
+    size_t plen = 0;
+    if (!MeshLz::decompress(f.data + pos, f.payload_len, reinterpret_cast<uint8_t*>(msg.payload),
+                            sizeof(msg.payload) - 1, plen)) {
+      return false;
+    }
+    msg.payload[plen] = '\0';
+  } else {
+    if (f.payload_len >= sizeof(msg.payload)) return false;
+    memcpy(msg.payload, f.data + pos, f.payload_len);
+  }
+
+  strncpy(msg.type, type, sizeof(msg.type) - 1);
+  snprintf(msg.sender, sizeof(msg.sender), "%02X:%02X:%02X:%02X:%02X:%02X",
+           f.sender[0], f.sender[1], f.sender[2], f.sender[3], f.sender[4], f.sender[5]);
+  msg.ttl = f.ttl;
+  msg.mid = f.mid;
+  return true;
+}
+
 // ================== POMOCNICZE ==================
 
 void MeshLib::_fillSender(standard_mesh_message &msg) const {
@@ -561,6 +2052,14 @@ bool MeshLib::_parseTargetMac(const char *payload, char *out_mac, size_t mac_siz
   return true;
 }
 
+void MeshLib::_selfMac(uint8_t out[6]) {
+#if defined(ARDUINO_ARCH_ESP32)
+  esp_wifi_get_mac(WIFI_IF_STA, out);
+#else
+  wifi_get_macaddr(STATION_IF, out);
+#endif
+}
+
 bool MeshLib::_isForUs(const char *target_mac) const {
   if (!target_mac || target_mac[0] == '\0') return false;
   String our_mac = WiFi.macAddress();
@@ -569,15 +2068,21 @@ bool MeshLib::_isForUs(const char *target_mac) const {
 
 // ================== DEDUP PO MID ==================
 
+bool MeshLib::_seen(uint32_t mid) const {
+  if (mid == 0) return false;
+  for (int i = 0; i < DEDUP_MAX; ++i) {
+    if (_dedup[i].mid == mid) return true;
+  }
+  return false;
+}
+
 bool MeshLib::_seenAndRemember(const standard_mesh_message &m) {
   const uint32_t mid = m.mid;
 
   if (mid == 0) return false; // brak MID -> nie deduplikujemy
 
-  for (int i = 0; i < DEDUP_MAX; ++i) {
-    if (_dedup[i].mid == mid) {
-      return true; // widziany wcześniej
-    }
+  if (_seen(mid)) {
+    return true; // widziany wcześniej
   }
 
   // nowy MID – zapisz w buforze cyklicznym
@@ -600,8 +2105,17 @@ bool MeshLib::loop() {
     return true;
   }
 
+  // Odroczone forwardy (tryb network coding)
+  _flushForwards();
+  _stepLinkRate();
+  _stepRetain();
+  _stepSubAdvert();
+  _stepHello();
+  _stepAggregate();
+  _stepDutyCycle();
+
   // Pick up pending OTA request outside of ESP-NOW callback context
-  if (!_ota_mode) {
+  if (_ota_state == MESH_OTA_IDLE) {
     ota_request req{};
     bool has_pending_ota = false;
 
@@ -618,13 +2132,9 @@ bool MeshLib::loop() {
     }
   }
 
-  // When OTA mode is active, prioritize OTA handling and signal caller
-  if (_ota_mode) {
+  // Jeden nieblokujący krok OTA; zajęci tylko podczas zapisu obrazu
+  if (_ota_state != MESH_OTA_IDLE) {
     _handleOTA();
-    return true;
   }
-  return false;
+  return _ota_state == MESH_OTA_UPDATING;
 }
-
-
-
@@ -0,0 +1,265 @@
+#include "meshLinkRate.h"
+#include <string.h>
+
+// kbps i minimalne RSSI (czułość ESP32 + ~6 dB), kolejność jak MeshPhyRate
+static const struct {
+  uint16_t kbps;
+  int8_t   min_rssi;
+  bool     lr;
+  bool     ofdm;
+} RATE_TABLE[MESH_PHY_COUNT] = {
+  {  250, -99, true,  false },  // LR 250K
+  {  500, -96, true,  false },  // LR 500K
+  { 1000, -92, false, false },  // 11b 1M
+  { 2000, -90, false, false },  // 11b 2M
+  { 5500, -88, false, false },  // 11b 5.5M
+  { 6000, -87, false, true  },  // 11g 6M
+  { 9000, -85, false, true  },  // 11g 9M
+  {11000, -82, false, false },  // 11b 11M
+  {12000, -83, false, true  },  // 11g 12M
+  {18000, -81, false, true  },  // 11g 18M
+  {24000, -78, false, true  },  // 11g 24M
+  {36000, -75, false, true  },  // 11g 36M
+  {48000, -71, false, true  },  // 11g 48M
+  {54000, -69, false, true  },  // 11g 54M
+};
+
+static const uint8_t MAX_PENALTY = 6;
+
+// ================== KONSTRUKTOR ==================
+
+MeshLinkRate::MeshLinkRate() {
+  memset(_neighbors, 0, sizeof(_neighbors));
+  memset(_pending, 0, sizeof(_pending));
+  _cfg.allow_lr    = false;
+  _cfg.allow_ofdm  = true;
+  _cfg.adapt_power = false;
+  _cfg.max_power_q = 78; // ~19.5 dBm, jak initMesh
+  _cfg.min_power_q = 8;  // 2 dBm
+  _cfg.fallback    = MESH_PHY_1M;
+}
+
+uint16_t MeshLinkRate::rateKbps(MeshPhyRate rate) {
+  return (rate < MESH_PHY_COUNT) ? RATE_TABLE[rate].kbps : 1000;
+}
+
+int8_t MeshLinkRate::rateMinRssi(MeshPhyRate rate) {
+  return (rate < MESH_PHY_COUNT) ? RATE_TABLE[rate].min_rssi : -92;
+}
+
+// ================== TABELA SĄSIADÓW ==================
+
+MeshLinkRate::Neighbor *MeshLinkRate::_find(const uint8_t mac[6]) {
+  for (size_t i = 0; i < MESH_LINK_MAX_NEIGHBORS; ++i) {
+    if (_neighbors[i].used && memcmp(_neighbors[i].mac, mac, 6) == 0) return &_neighbors[i];
+  }
+  return nullptr;
+}
+
+const MeshLinkRate::Neighbor *MeshLinkRate::_find(const uint8_t mac[6]) const {
+  return const_cast<MeshLinkRate*>(this)->_find(mac);
+}
+
+MeshLinkRate::Neighbor *MeshLinkRate::_findOrAdd(const uint8_t mac[6], uint32_t now_ms) {
+  Neighbor *n = _find(mac);
+  if (n) return n;
+
+  // wolny slot albo najdawniej słyszany sąsiad
+  Neighbor *victim = &_neighbors[0];
+  for (size_t i = 0; i < MESH_LINK_MAX_NEIGHBORS; ++i) {
+    Neighbor &c = _neighbors[i];
+    if (!c.used) { victim = &c; break; }
+    if (int32_t(c.last_ms - victim->last_ms) < 0) victim = &c;
+  }
+  // zwolniony slot nie może odziedziczyć oczekiwanych ech
+  const uint32_t bit = uint32_t(1) << (victim - _neighbors);
+  for (size_t i = 0; i < MESH_LINK_PENDING; ++i) _pending[i].expect &= ~bit;
+
+  memset(victim, 0, sizeof(*victim));
+  memcpy(victim->mac, mac, 6);
+  victim->used = true;
+  victim->last_ms = now_ms;
+  return victim;
+}
+
+void MeshLinkRate::onRssi(const uint8_t mac[6], int8_t rssi, uint32_t now_ms) {
+  const bool known = (_find(mac) != nullptr);
+  Neighbor *n = _findOrAdd(mac, now_ms);
+  const int16_t sample = int16_t(rssi) * 16;
+  if (!known) {
+    n->rssi_x16 = sample;
+  } else {
+    n->rssi_x16 += (sample - n->rssi_x16) / 4; // EWMA, alfa = 1/4
+  }
+  n->last_ms = now_ms;
+}
+
+void MeshLinkRate::onTxResult(const uint8_t mac[6], bool ok, uint32_t now_ms) {
+  Neighbor *n = _find(mac);
+  if (!n) return; // bez próbki RSSI nie ma od czego liczyć rate
+  n->last_ms = now_ms;
+  if (ok) {
+    if (n->tx_ok < 0xFFFF) n->tx_ok++;
+    if (++n->ok_streak >= MESH_LINK_RECOVER_SUCCESSES) {
+      n->ok_streak = 0;
+      if (n->penalty > 0) n->penalty--;
+    }
+  } else {
+    if (n->tx_fail < 0xFFFF) n->tx_fail++;
+    n->ok_streak = 0;
+    if (n->penalty < MAX_PENALTY) n->penalty++;
+  }
+}
+
+// ================== ECHA WŁASNYCH BROADCASTÓW ==================
+
+void MeshLinkRate::onBroadcast(uint32_t mid, uint32_t now_ms) {
+  expire(now_ms);
+
+  // wolny wpis albo najstarszy (wypada bez oceny — za mało miejsca to nie strata)
+  Pending *p = &_pending[0];
+  for (size_t i = 0; i < MESH_LINK_PENDING; ++i) {
+    Pending &c = _pending[i];
+    if (!c.used) { p = &c; break; }
+    if (int32_t(c.sent_ms - p->sent_ms) < 0) p = &c;
+  }
+
+  p->used = true;
+  p->mid = mid;
+  p->sent_ms = now_ms;
+  p->expect = 0;
+  for (size_t i = 0; i < MESH_LINK_MAX_NEIGHBORS; ++i) {
+    const Neighbor &n = _neighbors[i];
+    if (n.used && n.echoes && uint32_t(now_ms - n.last_ms) <= MESH_LINK_STALE_MS) {
+      p->expect |= uint32_t(1) << i;
+    }
+  }
+}
+
+void MeshLinkRate::onEcho(const uint8_t mac[6], uint32_t mid, uint32_t now_ms) {
+  Neighbor *n = _find(mac);
+  if (!n) return;
+  const uint32_t bit = uint32_t(1) << (n - _neighbors);
+  for (size_t i = 0; i < MESH_LINK_PENDING; ++i) {
+    Pending &p = _pending[i];
+    if (!p.used || p.mid != mid) continue;
+    if (!(p.expect & bit) && n->echoes) return; // drugie echo tej samej wiadomości
+    p.expect &= ~bit;
+  }
+  n->echoes = true;
+  onTxResult(mac, true, now_ms);
+}
+
+bool MeshLinkRate::awaiting(uint32_t mid) const {
+  for (size_t i = 0; i < MESH_LINK_PENDING; ++i) {
+    if (_pending[i].used && _pending[i].mid == mid) return true;
+  }
+  return false;
+}
+
+void MeshLinkRate::expire(uint32_t now_ms) {
+  for (size_t i = 0; i < MESH_LINK_PENDING; ++i) {
+    Pending &p = _pending[i];
+    if (!p.used || uint32_t(now_ms - p.sent_ms) < MESH_LINK_ECHO_MS) continue;
+    for (size_t k = 0; k < MESH_LINK_MAX_NEIGHBORS; ++k) {
+      Neighbor &n = _neighbors[k];
+      if (!(p.expect & (uint32_t(1) << k)) || !n.used) continue;
+      // bez echa przestaje być oczekiwany (mógł przestać forwardować,
+      // np. zmiana MPR) — kolejna strata liczy się dopiero po nowym echu
+      n.echoes = false;
+      if (n.tx_fail < 0xFFFF) n.tx_fail++;
+      n.ok_streak = 0;
+      if (n.penalty < MAX_PENALTY) n.penalty++;
+    }
+    p.used = false;
+  }
+}
+
+// ================== WYBÓR RATE / MOCY ==================
+
+bool MeshLinkRate::_allowed(MeshPhyRate rate) const {
+  if (RATE_TABLE[rate].lr && !_cfg.allow_lr) return false;
+  if (RATE_TABLE[rate].ofdm && !_cfg.allow_ofdm) return false;
+  return true;
+}
+
+mesh_link_choice MeshLinkRate::_choose(int16_t rssi, uint8_t penalty) const {
+  int fastest = -1;
+  int chosen = -1;
+  for (int r = MESH_PHY_COUNT - 1; r >= 0; --r) {
+    const MeshPhyRate rate = MeshPhyRate(r);
+    if (!_allowed(rate)) continue;
+    if (fastest < 0) fastest = r;
+    if (rssi - MESH_LINK_MARGIN_DB >= RATE_TABLE[r].min_rssi) { chosen = r; break; }
+  }
+
+  // kara za straty: o tyle dozwolonych kroków wolniej
+  int steps = penalty;
+  for (int r = chosen - 1; steps > 0 && r >= 0; --r) {
+    if (!_allowed(MeshPhyRate(r))) continue;
+    chosen = r;
+    --steps;
+  }
+
+  if (chosen < 0) {
+    // nawet najwolniejszy nie ma zapasu — najwolniejszy dozwolony
+    for (int r = 0; r < MESH_PHY_COUNT; ++r) {
+      if (_allowed(MeshPhyRate(r))) { chosen = r; break; }
+    }
+    if (chosen < 0) chosen = _cfg.fallback;
+  }
+
+  mesh_link_choice c{};
+  c.rate = MeshPhyRate(chosen);
+  c.kbps = RATE_TABLE[chosen].kbps;
+  c.power_q = _cfg.max_power_q;
+
+  // Moc obniżamy tylko przy najszybszym rate i bez strat: nadmiar zapasu
+  // i tak nie dałby szybszej transmisji.
+  if (_cfg.adapt_power && chosen == fastest && penalty == 0) {
+    const int excess_db = rssi - MESH_LINK_MARGIN_DB - RATE_TABLE[chosen].min_rssi;
+    int p = int(_cfg.max_power_q) - excess_db * 4;
+    if (p < _cfg.min_power_q) p = _cfg.min_power_q;
+    c.power_q = int8_t(p);
+  }
+  return c;
+}
+
+mesh_link_choice MeshLinkRate::selectBroadcast(uint32_t now_ms) const {
+  bool any = false;
+  mesh_link_choice worst{};
+  for (size_t i = 0; i < MESH_LINK_MAX_NEIGHBORS; ++i) {
+    const Neighbor &n = _neighbors[i];
+    if (!n.used || uint32_t(now_ms - n.last_ms) > MESH_LINK_STALE_MS) continue;
+    const mesh_link_choice c = _choose(n.rssi_x16 / 16, n.penalty);
+    if (!any) {
+      worst = c;
+      any = true;
+      continue;
+    }
+    if (c.kbps < worst.kbps) {
+      worst.rate = c.rate;
+      worst.kbps = c.kbps;
+    }
+    if (c.power_q > worst.power_q) worst.power_q = c.power_q;
+  }
+
+  if (!any) {
+    worst.rate = _cfg.fallback;
+    worst.kbps = rateKbps(_cfg.fallback);
+    worst.power_q = _cfg.max_power_q;
+  }
+  return worst;
+}
+
+bool MeshLinkRate::neighborAt(size_t i, mesh_link_info &out) const {
+  if (i >= MESH_LINK_MAX_NEIGHBORS || !_neighbors[i].used) return false;
+  const Neighbor &n = _neighbors[i];
+  memcpy(out.mac, n.mac, 6);
+  out.rssi    = n.rssi_x16 / 16;
+  out.penalty = n.penalty;
+  out.tx_ok   = n.tx_ok;
+  out.tx_fail = n.tx_fail;
+  out.last_ms = n.last_ms;
+  return true;
+}
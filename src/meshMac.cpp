@@ -0,0 +1,24 @@
+#include "meshMac.h"
+
+int meshHexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool meshParseMac(const char *str, uint8_t out[6]) {
+  if (!str || !out) return false;
+  for (int i = 0; i < 6; ++i) {
+    const int hi = meshHexValue(str[0]);
+    const int lo = (hi < 0) ? -1 : meshHexValue(str[1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = uint8_t((hi << 4) | lo);
+    str += 2;
+    if (i < 5) {
+      if (*str != ':' && *str != '-') return false;
+      ++str;
+    }
+  }
+  return true;
+}
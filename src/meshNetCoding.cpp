@@ -0,0 +1,129 @@
+#include "meshNetCoding.h"
+#include <string.h>
+
+// ================== KONSTRUKTOR ==================
+
+MeshNetCoder::MeshNetCoder() {
+  memset(_neighbors, 0, sizeof(_neighbors));
+  memset(_cache, 0, sizeof(_cache));
+}
+
+// ================== CO SŁYSZELI SĄSIEDZI ==================
+
+void MeshNetCoder::onHeard(const uint8_t nb[6], uint32_t mid, uint32_t now_ms) {
+  if (mid == 0) return;
+
+  Neighbor *n = nullptr;
+  Neighbor *victim = &_neighbors[0];
+  for (size_t i = 0; i < MESH_NC_NEIGHBORS; ++i) {
+    Neighbor &c = _neighbors[i];
+    if (c.used && memcmp(c.mac, nb, 6) == 0) { n = &c; break; }
+    if (!victim->used) continue;
+    if (!c.used || int32_t(c.last_ms - victim->last_ms) < 0) victim = &c;
+  }
+  if (!n) {
+    n = victim;
+    memset(n, 0, sizeof(*n));
+    memcpy(n->mac, nb, 6);
+    n->used = true;
+  }
+  n->last_ms = now_ms;
+
+  for (size_t i = 0; i < MESH_NC_HEARD; ++i) {
+    if (n->heard[i].mid == mid) return;
+  }
+  n->heard[n->heard_idx].mid = mid;
+  n->heard[n->heard_idx].seq = _remembered;
+  n->heard_idx = uint8_t((n->heard_idx + 1) % MESH_NC_HEARD);
+}
+
+// Sąsiad ma mid i nadal ma go w cache. Jego cache przesuwa się podobnie jak
+// nasz (ten sam ruch), ale wcześniej: dostał wiadomość, zanim ją od niego
+// usłyszeliśmy, i do tego czasu trzymał ją w kolejce forwardów. Dlatego
+// liczy się tylko, gdy od usłyszenia dopisaliśmy do cache mniej niż połowę
+// MESH_NC_CACHE nowych wiadomości — druga połowa to zapas na to opóźnienie.
+bool MeshNetCoder::_hasHeard(const Neighbor &n, uint32_t mid) const {
+  for (size_t i = 0; i < MESH_NC_HEARD; ++i) {
+    if (n.heard[i].mid == mid) return uint32_t(_remembered - n.heard[i].seq) < MESH_NC_CACHE / 2;
+  }
+  return false;
+}
+
+bool MeshNetCoder::canCombine(uint32_t mid_a, uint32_t mid_b, uint32_t now_ms) const {
+  if (mid_a == 0 || mid_b == 0 || mid_a == mid_b) return false;
+
+  // Ramka XOR jest bezużyteczna dla sąsiada, który nie ma żadnej z dwóch
+  // wiadomości — wtedy wysyłamy je osobno. Poza tym para musi iść "na krzyż"
+  // (ktoś ma tylko a, ktoś tylko b): dwie wiadomości z tej samej strony zna
+  // tylko sąsiad, od którego przyszły, a dalszy sąsiad, którego jeszcze nie
+  // słyszeliśmy, nie zdekodowałby żadnej.
+  bool only_a = false;
+  bool only_b = false;
+  for (size_t i = 0; i < MESH_NC_NEIGHBORS; ++i) {
+    const Neighbor &n = _neighbors[i];
+    if (!n.used || uint32_t(now_ms - n.last_ms) > MESH_NC_NEIGHBOR_MS) continue;
+    const bool has_a = _hasHeard(n, mid_a);
+    const bool has_b = _hasHeard(n, mid_b);
+    if (!has_a && !has_b) return false;
+    only_a |= has_a && !has_b;
+    only_b |= has_b && !has_a;
+  }
+  return only_a && only_b;
+}
+
+// ================== CACHE TREŚCI ==================
+
+void MeshNetCoder::remember(uint32_t mid, const uint8_t body[MESH_NC_BODY_LEN]) {
+  if (mid == 0 || lookup(mid)) return;
+  _cache[_cache_idx].mid = mid;
+  ++_remembered;
+  memcpy(_cache[_cache_idx].body, body, MESH_NC_BODY_LEN);
+  _cache_idx = (_cache_idx + 1) % MESH_NC_CACHE;
+}
+
+const uint8_t *MeshNetCoder::lookup(uint32_t mid) const {
+  if (mid == 0) return nullptr;
+  for (size_t i = 0; i < MESH_NC_CACHE; ++i) {
+    if (_cache[i].mid == mid) return _cache[i].body;
+  }
+  return nullptr;
+}
+
+// ================== KODOWANIE ==================
+
+size_t MeshNetCoder::encode(mesh_coded_frame &out,
+                            uint32_t mid_a, int8_t ttl_a, const uint8_t *body_a,
+                            uint32_t mid_b, int8_t ttl_b, const uint8_t *body_b) {
+  out.magic    = MESH_NC_MAGIC;
+  out.ttl_a    = ttl_a;
+  out.ttl_b    = ttl_b;
+  out.flags    = 0;
+  out.mid_a    = mid_a;
+  out.mid_b    = mid_b;
+
+  // krótkie wiadomości to głównie zera (puste końcówki topic/payload) —
+  // wysyłamy tylko do ostatniego bajtu, który nie jest zerem w żadnej z nich
+  size_t used = 0;
+  for (size_t i = 0; i < MESH_NC_BODY_LEN; ++i) {
+    if (body_a[i] | body_b[i]) used = i + 1;
+    out.body[i] = uint8_t(body_a[i] ^ body_b[i]);
+  }
+  // starsze węzły (i MeshLib przed sprawdzeniem magic) wzięłyby ją za
+  // standard_mesh_message
+  if (MESH_NC_HEADER_LEN + used == MESH_NC_LEGACY_LEN) ++used;
+  return MESH_NC_HEADER_LEN + used;
+}
+
+bool MeshNetCoder::decode(const mesh_coded_frame &in, size_t len, uint32_t known_mid,
+                          uint8_t out_body[MESH_NC_BODY_LEN]) const {
+  if (len < MESH_NC_HEADER_LEN || len > MESH_NC_FRAME_LEN) return false;
+  if (in.magic != MESH_NC_MAGIC) return false;
+  if (known_mid != in.mid_a && known_mid != in.mid_b) return false;
+  const uint8_t *known = lookup(known_mid);
+  if (!known) return false;
+  const size_t used = len - MESH_NC_HEADER_LEN;
+  for (size_t i = 0; i < MESH_NC_BODY_LEN; ++i) {
+    out_body[i] = uint8_t((i < used ? in.body[i] : 0) ^ known[i]);
+  }
+  return true;
+}
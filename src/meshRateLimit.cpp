@@ -0,0 +1,153 @@
+#include "meshRateLimit.h"
+#include <string.h>
+
+// Nagłówki ramki ESP-NOW (MAC 24 + vendor action/IE ~15 + FCS 4) i preambuła 11B
+static const uint32_t ESPNOW_FRAME_OVERHEAD = 43;
+static const uint32_t PHY_PREAMBLE_US       = 192;
+
+static uint32_t macHash(const uint8_t mac[6]) {
+  uint32_t h = 2166136261u; // FNV-1a
+  for (int i = 0; i < 6; ++i) {
+    h ^= mac[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static uint16_t satInc(uint16_t v) {
+  return (v == 0xFFFF) ? v : uint16_t(v + 1);
+}
+
+// ================== KONSTRUKTOR / KONFIGURACJA ==================
+
+MeshRateLimiter::MeshRateLimiter() {
+  memset(_origins, 0, sizeof(_origins));
+  _limits[MESH_PRIO_CONTROL] = {MESH_RL_CONTROL_RATE, MESH_RL_CONTROL_BURST};
+  _limits[MESH_PRIO_DATA]    = {MESH_RL_DATA_RATE,    MESH_RL_DATA_BURST};
+}
+
+void MeshRateLimiter::setLimit(MeshPriority prio, uint16_t rate, uint16_t burst) {
+  if (prio >= MESH_PRIO_COUNT) return;
+  _limits[prio].rate  = rate;
+  _limits[prio].burst = burst ? burst : 1;
+}
+
+void MeshRateLimiter::setAirtimeBudget(uint16_t permille, uint16_t data_reserve_permille) {
+  _airtime_permille      = (permille > 1000) ? 1000 : permille;
+  _data_reserve_permille = (data_reserve_permille > 1000) ? 1000 : data_reserve_permille;
+  _airtime_started = false; // przelicz pojemność od nowa
+}
+
+void MeshRateLimiter::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+  for (size_t i = 0; i < MESH_RL_ORIGINS; ++i) {
+    memset(_origins[i].shed, 0, sizeof(_origins[i].shed));
+  }
+}
+
+// ================== TOKEN BUCKET ==================
+
+void MeshRateLimiter::_refill(Origin &o, uint32_t now_ms) const {
+  const uint32_t elapsed = now_ms - o.last_ms;
+  o.last_ms = now_ms;
+  for (int p = 0; p < MESH_PRIO_COUNT; ++p) {
+    const uint32_t cap = uint32_t(_limits[p].burst) * 1000u;
+    // rate [1/s] == mili-tokeny na ms
+    const uint64_t t = uint64_t(o.tokens[p]) + uint64_t(elapsed) * _limits[p].rate;
+    o.tokens[p] = (t > cap) ? cap : uint32_t(t);
+  }
+}
+
+void MeshRateLimiter::_refillAirtime(uint32_t now_ms) {
+  // permille promili z każdej ms to permille µs
+  const uint32_t cap = uint32_t(MESH_AIRTIME_WINDOW_MS) * _airtime_permille;
+  if (!_airtime_started) {
+    _airtime_started = true;
+    _airtime_last_ms = now_ms;
+    _airtime_us = cap;
+    return;
+  }
+  const uint32_t elapsed = now_ms - _airtime_last_ms;
+  _airtime_last_ms = now_ms;
+  const uint64_t t = uint64_t(_airtime_us) + uint64_t(elapsed) * _airtime_permille;
+  _airtime_us = (t > cap) ? cap : uint32_t(t);
+}
+
+MeshRateLimiter::Origin *MeshRateLimiter::_lookup(const uint8_t mac[6], uint32_t now_ms) {
+  const size_t sets = MESH_RL_ORIGINS / MESH_RL_WAYS;
+  Origin *set = &_origins[(macHash(mac) % sets) * MESH_RL_WAYS];
+
+  Origin *victim = &set[0];
+  for (int w = 0; w < MESH_RL_WAYS; ++w) {
+    Origin &o = set[w];
+    if (o.used && memcmp(o.mac, mac, 6) == 0) return &o;
+    if (!o.used) {
+      if (victim->used) victim = &o;
+    } else if (victim->used && int32_t(o.last_ms - victim->last_ms) < 0) {
+      victim = &o; // najdawniej widziany
+    }
+  }
+
+  // nowy origin: pełne kubełki, wyparcie LRU w obrębie zbioru
+  memset(victim, 0, sizeof(*victim));
+  memcpy(victim->mac, mac, 6);
+  victim->used = true;
+  victim->last_ms = now_ms;
+  for (int p = 0; p < MESH_PRIO_COUNT; ++p) {
+    victim->tokens[p] = uint32_t(_limits[p].burst) * 1000u;
+  }
+  return victim;
+}
+
+MeshForwardVerdict MeshRateLimiter::admit(const uint8_t origin[6], MeshPriority prio,
+                                          uint32_t airtime_us, uint32_t now_ms) {
+  if (prio >= MESH_PRIO_COUNT) prio = MESH_PRIO_DATA;
+  if (!_enabled) {
+    _stats.forwarded[prio]++;
+    return MESH_FWD_OK;
+  }
+
+  Origin *o = _lookup(origin, now_ms);
+  _refill(*o, now_ms);
+
+  const bool limited = (_limits[prio].rate != 0);
+  if (limited && o->tokens[prio] < 1000u) {
+    o->shed[prio] = satInc(o->shed[prio]);
+    _stats.shed_rate[prio]++;
+    return MESH_FWD_SHED_RATE;
+  }
+
+  if (_airtime_permille != 0) {
+    _refillAirtime(now_ms);
+    const uint32_t cap = uint32_t(MESH_AIRTIME_WINDOW_MS) * _airtime_permille;
+    const uint32_t reserve = (prio == MESH_PRIO_CONTROL)
+                               ? 0
+                               : uint32_t((uint64_t(cap) * _data_reserve_permille) / 1000u);
+    if (uint64_t(_airtime_us) < uint64_t(airtime_us) + reserve) {
+      o->shed[prio] = satInc(o->shed[prio]);
+      _stats.shed_airtime[prio]++;
+      return MESH_FWD_SHED_AIRTIME;
+    }
+    _airtime_us -= airtime_us;
+  }
+
+  if (limited) o->tokens[prio] -= 1000u;
+  _stats.forwarded[prio]++;
+  return MESH_FWD_OK;
+}
+
+// ================== STATYSTYKI / POMOCNICZE ==================
+
+bool MeshRateLimiter::originAt(size_t i, mesh_origin_stats &out) const {
+  if (i >= MESH_RL_ORIGINS || !_origins[i].used) return false;
+  const Origin &o = _origins[i];
+  memcpy(out.mac, o.mac, 6);
+  memcpy(out.shed, o.shed, sizeof(out.shed));
+  out.last_ms = o.last_ms;
+  return true;
+}
+
+uint32_t MeshRateLimiter::airtimeUs(size_t len, uint32_t rate_kbps) {
+  if (rate_kbps == 0) rate_kbps = 1000;
+  return PHY_PREAMBLE_US + uint32_t(((uint64_t(len) + ESPNOW_FRAME_OVERHEAD) * 8000u) / rate_kbps);
+}
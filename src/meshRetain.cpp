@@ -0,0 +1,99 @@
+#include "meshRetain.h"
+#include <string.h>
+
+// ================== PULA WPISÓW ==================
+
+bool MeshRetainStore::_locate(const char *topic, size_t &off) const {
+  const size_t tlen = strlen(topic);
+  for (size_t o = 0; o < _used; o += _entryLen(o)) {
+    if (_pool[o] == tlen && memcmp(&_pool[o + HDR], topic, tlen) == 0) {
+      off = o;
+      return true;
+    }
+  }
+  return false;
+}
+
+void MeshRetainStore::_erase(size_t off) {
+  const size_t len = _entryLen(off);
+  memmove(&_pool[off], &_pool[off + len], _used - off - len);
+  _used -= len;
+  _count--;
+}
+
+void MeshRetainStore::_read(size_t off, mesh_retained &out) const {
+  const size_t tlen = _pool[off];
+  const size_t plen = _pool[off + 1];
+  memcpy(out.publisher, &_pool[off + 2], 6);
+  memcpy(out.topic, &_pool[off + HDR], tlen);
+  out.topic[tlen] = '\0';
+  memcpy(out.payload, &_pool[off + HDR + tlen], plen);
+  out.payload[plen] = '\0';
+}
+
+bool MeshRetainStore::put(const char *topic, const char *payload, const uint8_t publisher[6]) {
+  if (!topic || topic[0] == '\0') return false;
+  const size_t tlen = strnlen(topic, MESH_RETAIN_TOPIC_MAX);
+  const size_t plen = payload ? strnlen(payload, MESH_RETAIN_PAYLOAD_MAX) : 0;
+  if (tlen >= MESH_RETAIN_TOPIC_MAX || plen >= MESH_RETAIN_PAYLOAD_MAX) return false;
+
+  size_t off;
+  if (_locate(topic, off)) _erase(off);
+  if (plen == 0) return true; // usunięcie
+
+  const size_t need = HDR + tlen + plen;
+  if (need > MESH_RETAIN_POOL_BYTES) return false;
+  while (_used + need > MESH_RETAIN_POOL_BYTES) {
+    _erase(0); // najdawniej aktualizowany
+  }
+
+  uint8_t *e = &_pool[_used];
+  e[0] = uint8_t(tlen);
+  e[1] = uint8_t(plen);
+  memcpy(&e[2], publisher, 6);
+  const uint32_t seq = ++_seq;
+  memcpy(&e[8], &seq, sizeof(seq));
+  memcpy(&e[HDR], topic, tlen);
+  memcpy(&e[HDR + tlen], payload, plen);
+  _used += need;
+  _count++;
+  return true;
+}
+
+bool MeshRetainStore::remove(const char *topic) {
+  size_t off;
+  if (!topic || !_locate(topic, off)) return false;
+  _erase(off);
+  return true;
+}
+
+bool MeshRetainStore::find(const char *topic, mesh_retained &out) const {
+  size_t off;
+  if (!topic || !_locate(topic, off)) return false;
+  _read(off, out);
+  return true;
+}
+
+bool MeshRetainStore::at(size_t i, mesh_retained &out) const {
+  size_t o = 0;
+  for (size_t n = 0; o < _used; ++n, o += _entryLen(o)) {
+    if (n == i) {
+      _read(o, out);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MeshRetainStore::next(uint32_t after, mesh_retained &out, uint32_t &seq) const {
+  // wpisy leżą rosnąco po seq → pierwszy nowszy od `after`
+  for (size_t o = 0; o < _used; o += _entryLen(o)) {
+    const uint32_t s = _seqAt(o);
+    if (int32_t(s - after) > 0) {
+      _read(o, out);
+      seq = s;
+      return true;
+    }
+  }
+  return false;
+}
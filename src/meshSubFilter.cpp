@@ -0,0 +1,154 @@
+#include "meshSubFilter.h"
+#include <string.h>
+
+// ================== KONSTRUKTOR ==================
+
+MeshSubFilter::MeshSubFilter() {
+  memset(_neighbors, 0, sizeof(_neighbors));
+  memset(_local, 0, sizeof(_local));
+  memset(_last_advert, 0, sizeof(_last_advert));
+}
+
+// ================== FILTR BLOOMA ==================
+
+// Podwójne haszowanie z jednego mnożenia (ID topicu jest już haszem)
+void MeshSubFilter::bloomAdd(uint8_t bits[MESH_SF_BYTES], uint16_t topic_id) {
+  const uint32_t h = topic_id * 2654435761u;
+  const uint32_t h1 = h >> 16;
+  const uint32_t h2 = (h & 0xFFFFu) | 1u;
+  for (uint32_t i = 0; i < MESH_SF_HASHES; ++i) {
+    const uint32_t bit = (h1 + i * h2) % (MESH_SF_BYTES * 8);
+    bits[bit >> 3] |= uint8_t(1u << (bit & 7));
+  }
+}
+
+bool MeshSubFilter::bloomTest(const uint8_t bits[MESH_SF_BYTES], uint16_t topic_id) {
+  const uint32_t h = topic_id * 2654435761u;
+  const uint32_t h1 = h >> 16;
+  const uint32_t h2 = (h & 0xFFFFu) | 1u;
+  for (uint32_t i = 0; i < MESH_SF_HASHES; ++i) {
+    const uint32_t bit = (h1 + i * h2) % (MESH_SF_BYTES * 8);
+    if (!(bits[bit >> 3] & (1u << (bit & 7)))) return false;
+  }
+  return true;
+}
+
+// ================== WŁASNE SUBSKRYPCJE ==================
+
+void MeshSubFilter::clearLocal() {
+  memset(_local, 0, sizeof(_local));
+}
+
+void MeshSubFilter::addLocal(uint16_t topic_id) {
+  bloomAdd(_local, topic_id);
+}
+
+void MeshSubFilter::setWantAll(bool want_all) {
+  memset(_local, want_all ? 0xFF : 0x00, sizeof(_local));
+}
+
+// ================== SĄSIEDZI ==================
+
+MeshSubFilter::Neighbor *MeshSubFilter::_neighbor(const uint8_t nb[6], uint32_t now_ms) {
+  Neighbor *victim = &_neighbors[0];
+  for (size_t i = 0; i < MESH_SF_NEIGHBORS; ++i) {
+    Neighbor &c = _neighbors[i];
+    if (c.used && memcmp(c.mac, nb, 6) == 0) return &c;
+    if (!victim->used) continue;
+    if (!c.used || int32_t(c.last_ms - victim->last_ms) < 0) victim = &c;
+  }
+  memset(victim, 0, sizeof(*victim));
+  memcpy(victim->mac, nb, 6);
+  victim->used = true;
+  victim->last_ms = now_ms;
+  return victim;
+}
+
+void MeshSubFilter::onHeard(const uint8_t nb[6], uint32_t now_ms) {
+  _neighbor(nb, now_ms)->last_ms = now_ms;
+}
+
+bool MeshSubFilter::onAdvert(const uint8_t nb[6], const uint8_t *data, size_t len, uint32_t now_ms) {
+  if (len < offsetof(mesh_sub_advert, filter) || data[0] != MESH_SF_MAGIC) return false;
+  const uint8_t levels = data[1];
+  if (data[2] != MESH_SF_BYTES || levels == 0 ||
+      len != offsetof(mesh_sub_advert, filter) + size_t(levels) * MESH_SF_BYTES) {
+    return false;
+  }
+
+  Neighbor *n = _neighbor(nb, now_ms);
+  // przerwa dłuższa niż MESH_SF_EXPIRE_MS = poziomy od nowa niepewne
+  if (!n->has_filter || !_fresh(n->filter_ms, now_ms)) n->adverts = 0;
+  if (n->adverts < MESH_SF_LEVELS) n->adverts++;
+  n->last_ms = now_ms;
+  n->filter_ms = now_ms;
+  n->has_filter = true;
+  // Sąsiad z mniejszą liczbą poziomów: brakujące = "wszystko" (bezpiecznie)
+  const uint8_t *src = data + offsetof(mesh_sub_advert, filter);
+  for (size_t l = 0; l < MESH_SF_LEVELS; ++l) {
+    if (l < levels) memcpy(n->filter[l], src + l * MESH_SF_BYTES, MESH_SF_BYTES);
+    else memset(n->filter[l], 0xFF, MESH_SF_BYTES);
+  }
+  _stats.adverts_heard++;
+  return true;
+}
+
+// ================== OGŁOSZENIE ==================
+
+bool MeshSubFilter::buildAdvert(mesh_sub_advert &out, uint32_t now_ms) {
+  out.magic = MESH_SF_MAGIC;
+  out.levels = MESH_SF_LEVELS;
+  out.bytes = MESH_SF_BYTES;
+  memset(out.filter, 0, sizeof(out.filter));
+  memcpy(out.filter[0], _local, MESH_SF_BYTES);
+
+  for (size_t i = 0; i < MESH_SF_NEIGHBORS; ++i) {
+    const Neighbor &n = _neighbors[i];
+    if (!n.used || !n.has_filter || !_fresh(n.filter_ms, now_ms)) continue;
+    for (size_t l = 1; l < MESH_SF_LEVELS; ++l) {
+      for (size_t b = 0; b < MESH_SF_BYTES; ++b) out.filter[l][b] |= n.filter[l - 1][b];
+    }
+  }
+
+  const bool changed = memcmp(out.filter, _last_advert, sizeof(_last_advert)) != 0;
+  memcpy(_last_advert, out.filter, sizeof(_last_advert));
+  return changed;
+}
+
+// ================== DECYZJA O FORWARDZIE ==================
+
+bool MeshSubFilter::shouldForward(uint16_t topic_id, int ttl_left, uint32_t now_ms) {
+  if (ttl_left <= 0) return false;
+  if (ttl_left > MESH_SF_LEVELS) {
+    _stats.fallback++; // filtry nie sięgają tak daleko
+    return true;
+  }
+
+  bool any = false;
+  for (size_t i = 0; i < MESH_SF_NEIGHBORS; ++i) {
+    const Neighbor &n = _neighbors[i];
+    if (!n.used || !_fresh(n.last_ms, now_ms)) continue;
+    any = true;
+    if (!n.has_filter || !_fresh(n.filter_ms, now_ms)) {
+      _stats.fallback++; // nieznany sąsiad (starsza wersja / jeszcze bez ogłoszenia)
+      return true;
+    }
+    if (n.adverts < MESH_SF_LEVELS) {
+      _stats.fallback++; // głębsze poziomy sąsiada jeszcze się nie rozeszły
+      return true;
+    }
+    for (int l = 0; l < ttl_left; ++l) {
+      if (bloomTest(n.filter[l], topic_id)) {
+        _stats.forwarded++;
+        return true;
+      }
+    }
+  }
+
+  if (!any) {
+    _stats.fallback++; // nikogo jeszcze nie słyszeliśmy
+    return true;
+  }
+  _stats.pruned++;
+  return false;
+}
@@ -0,0 +1,253 @@
+// meshbb — sprawdzenie wyboru relayów MPR (MeshBackbone) na stałych topologiach (host).
+//
+//   g++ -O2 -std=c++11 -Iinclude tools/meshbb/meshbb.cpp src/meshBackbone.cpp -o meshbb
+//
+//   meshbb [floody_na_źródło=20]
+//
+// Dla każdej topologii węzły wymieniają hello jak MeshLib z setBackbone(true)
+// (kilka okresów MESH_BB_HELLO_MS), po czym sprawdzane jest, że:
+//   - MPR-y każdego węzła pokrywają wszystkie węzły 2 hopy od niego,
+//   - flood z każdego źródła (przekazuje tylko ten, kogo nadawca kopii wybrał
+//     na MPR — MeshBackbone::shouldRelay / relayDuplicate) dociera do wszystkich,
+//   - transmisji na flood jest nie więcej niż w pełnym floodzie (N).
+// Kolejność kopii w jednym hopie jest losowa (stałe ziarno), jak backoff
+// w eterze. Model bez strat. Kod wyjścia 0 = wszystkie topologie poprawne.
+
+#include "meshBackbone.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+static uint32_t s_rand = 12345;
+static uint32_t rnd() {
+  s_rand = s_rand * 1103515245u + 12345u;
+  return s_rand >> 8;
+}
+
+// ================== TOPOLOGIE ==================
+
+struct Topology {
+  const char *name;
+  int n;
+  std::vector<std::vector<bool>> adj;
+
+  Topology(const char *nm, int count) : name(nm), n(count), adj(count, std::vector<bool>(count, false)) {}
+  void link(int a, int b) { if (a != b) adj[a][b] = adj[b][a] = true; }
+  int degree(int a) const {
+    int d = 0;
+    for (int b = 0; b < n; ++b) d += adj[a][b];
+    return d;
+  }
+};
+
+static Topology line(int n) {
+  Topology t("line", n);
+  for (int i = 0; i + 1 < n; ++i) t.link(i, i + 1);
+  return t;
+}
+
+static Topology ring(int n) {
+  Topology t("ring", n);
+  for (int i = 0; i < n; ++i) t.link(i, (i + 1) % n);
+  return t;
+}
+
+static Topology star(int leaves) {
+  Topology t("star", leaves + 1);
+  for (int i = 1; i <= leaves; ++i) t.link(0, i);
+  return t;
+}
+
+// king = 8 sąsiadów (gęsta siatka), inaczej 4
+static Topology grid(int w, int h, bool king) {
+  Topology t(king ? "grid8" : "grid4", w * h);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          if (!king && dx && dy) continue;
+          const int nx = x + dx, ny = y + dy;
+          if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+          t.link(y * w + x, ny * w + nx);
+        }
+      }
+    }
+  }
+  return t;
+}
+
+// losowe punkty w kwadracie, łącze do odległości r; losuje od nowa, aż sieć
+// jest spójna i nikt nie ma więcej sąsiadów niż MESH_BB_NEIGHBORS
+static Topology geometric(int n, double side, double r) {
+  while (true) {
+    Topology t("random", n);
+    std::vector<double> px(n), py(n);
+    for (int i = 0; i < n; ++i) {
+      px[i] = side * (rnd() % 10000) / 10000.0;
+      py[i] = side * (rnd() % 10000) / 10000.0;
+    }
+    for (int a = 0; a < n; ++a) {
+      for (int b = a + 1; b < n; ++b) {
+        if (hypot(px[a] - px[b], py[a] - py[b]) <= r) t.link(a, b);
+      }
+    }
+    bool ok = true;
+    for (int a = 0; a < n && ok; ++a) ok = t.degree(a) > 0 && t.degree(a) <= MESH_BB_NEIGHBORS;
+    std::vector<bool> seen(n, false);
+    std::vector<int> stack(1, 0);
+    seen[0] = true;
+    int reached = 1;
+    while (!stack.empty()) {
+      const int a = stack.back();
+      stack.pop_back();
+      for (int b = 0; b < n; ++b) {
+        if (t.adj[a][b] && !seen[b]) { seen[b] = true; ++reached; stack.push_back(b); }
+      }
+    }
+    if (ok && reached == n) return t;
+  }
+}
+
+// ================== SYMULACJA ==================
+
+static void macOf(int idx, uint8_t mac[6]) {
+  const uint8_t m[6] = {0x02, 0, 0, 0, uint8_t(idx >> 8), uint8_t(idx)};
+  memcpy(mac, m, 6);
+}
+
+static int indexOf(const uint8_t mac[6]) {
+  return (mac[4] << 8) | mac[5];
+}
+
+struct Result {
+  bool covered = true;
+  size_t mprs = 0;
+  size_t floods = 0, delivered = 0, expected = 0, tx = 0;
+};
+
+static Result run(const Topology &t, int floods_per_source) {
+  std::vector<MeshBackbone> bb(t.n);
+  for (int i = 0; i < t.n; ++i) {
+    uint8_t mac[6];
+    macOf(i, mac);
+    bb[i].setSelf(mac);
+  }
+
+  // wymiana hello: łącze symetryczne, 2 hopy, MPR, wybór ogłoszony selektorom
+  uint32_t now = 0;
+  std::vector<mesh_hello> hello(t.n);
+  std::vector<size_t> len(t.n);
+  for (int round = 0; round < 5; ++round) {
+    now += MESH_BB_HELLO_MS;
+    for (int i = 0; i < t.n; ++i) len[i] = bb[i].buildHello(hello[i], now);
+    for (int i = 0; i < t.n; ++i) {
+      uint8_t mac[6];
+      macOf(i, mac);
+      for (int j = 0; j < t.n; ++j) {
+        if (t.adj[i][j]) bb[j].onHello(mac, reinterpret_cast<const uint8_t*>(&hello[i]), len[i], now);
+      }
+    }
+  }
+
+  Result res;
+
+  // pokrycie: każdy węzeł 2 hopy dalej jest sąsiadem któregoś z wybranych MPR
+  for (int i = 0; i < t.n; ++i) {
+    mesh_hello h;
+    bb[i].buildHello(h, now);
+    std::vector<bool> mpr(t.n, false);
+    for (size_t e = 0; e < h.count; ++e) {
+      if (h.entries[e].flags & MESH_BB_MPR) mpr[indexOf(h.entries[e].mac)] = true;
+    }
+    res.mprs += bb[i].mprCount();
+    for (int y = 0; y < t.n; ++y) {
+      if (y == i || t.adj[i][y]) continue;
+      bool two_hop = false, covered = false;
+      for (int m = 0; m < t.n; ++m) {
+        if (!t.adj[i][m] || !t.adj[m][y]) continue;
+        two_hop = true;
+        if (mpr[m]) covered = true;
+      }
+      if (two_hop && !covered) {
+        printf("  %s: node %d does not cover 2-hop node %d\n", t.name, i, y);
+        res.covered = false;
+      }
+    }
+  }
+
+  // flood z każdego źródła: w każdym hopie kopie docierają w losowej kolejności
+  uint32_t mid = 0;
+  for (int src = 0; src < t.n; ++src) {
+    for (int f = 0; f < floods_per_source; ++f) {
+      ++mid;
+      std::vector<bool> got(t.n, false);
+      std::vector<int> wave(1, src);
+      got[src] = true;
+      size_t reached = 1;
+      while (!wave.empty()) {
+        res.tx += wave.size();
+        // (odbiorca, nadawca) w kolejności odbioru
+        std::vector<std::pair<int, int>> copies;
+        for (int tx : wave) {
+          for (int rx = 0; rx < t.n; ++rx) {
+            if (t.adj[tx][rx]) copies.push_back(std::make_pair(rx, tx));
+          }
+        }
+        for (size_t k = copies.size(); k > 1; --k) std::swap(copies[k - 1], copies[rnd() % k]);
+
+        std::vector<int> next;
+        for (const auto &c : copies) {
+          uint8_t mac[6];
+          macOf(c.second, mac);
+          if (got[c.first]) {
+            // duplikat: relay, jeśli pierwsza kopia była od nie-selektora
+            if (bb[c.first].relayDuplicate(mac, mid, now)) next.push_back(c.first);
+            continue;
+          }
+          got[c.first] = true;
+          ++reached;
+          if (bb[c.first].shouldRelay(mac, mid, now)) next.push_back(c.first);
+        }
+        wave.swap(next);
+      }
+      res.floods++;
+      res.delivered += reached;
+      res.expected += size_t(t.n);
+    }
+  }
+  return res;
+}
+
+// ================== MAIN ==================
+
+int main(int argc, char **argv) {
+  const int floods = argc > 1 ? atoi(argv[1]) : 20;
+  if (floods < 1) {
+    fprintf(stderr, "usage: meshbb [floods_per_source=20]\n");
+    return 2;
+  }
+
+  std::vector<Topology> topologies;
+  topologies.push_back(line(8));
+  topologies.push_back(ring(10));
+  topologies.push_back(star(12));
+  topologies.push_back(grid(5, 5, false));
+  topologies.push_back(grid(6, 6, true));
+  topologies.push_back(geometric(40, 100.0, 25.0));
+
+  bool ok = true;
+  for (const Topology &t : topologies) {
+    const Result r = run(t, floods);
+    const double per_flood = double(r.tx) / double(r.floods);
+    const bool delivered = r.delivered == r.expected;
+    const bool fewer = per_flood <= double(t.n);
+    printf("%-7s %3d nodes  MPR/node %4.2f  tx/flood %5.1f (flood %d)  delivered %zu/%zu  %s\n",
+           t.name, t.n, double(r.mprs) / t.n, per_flood, t.n, r.delivered, r.expected,
+           (r.covered && delivered && fewer) ? "ok" : "FAIL");
+    ok = ok && r.covered && delivered && fewer;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+// meshdc — symulacja skoordynowanego snu: rodzic + śpiące dzieci (host).
+//
+//   g++ -O2 -std=c++11 -Iinclude tools/meshdc/meshdc.cpp src/meshDutyCycle.cpp -o meshdc
+//
+//   meshdc [okres_ms=2000] [okno_ms=30] [dzieci=3] [odstęp_ms=500] [czas_s=600]
+//
+// Zegar symulowany co 1 ms. Rodzic (setSleepParent) słyszy cały ruch mesh:
+// wiadomość z sieci co odstęp_ms na jeden z 4 topiców, a każde dziecko co
+// ~7 s publikuje własną (wakeForSend, okno MESH_DC_TX_MS). Rodzic buforuje
+// kopie jak MeshLib::_offerSleepy — ten sam MID, TTL 1, źródło = autor — i
+// wysyła serię ramką co MESH_DC_FRAME_MS / 2 jak _stepDutyCycle. Dzieci
+// startują z przesunięciem i mają różne subskrypcje (dziecko 0 — wszystko).
+// Sprawdzane jest, że:
+//   - każda wiadomość zbuforowana dla dziecka do niego dociera (poza
+//     wypchniętymi z pełnej kolejki),
+//   - opóźnienie ≤ okres + MESH_DC_WINDOW_MAX_MS,
+//   - rodzic nie buforuje dla dziecka jego własnej wiadomości (dziecko
+//     subskrybuje topic, na który publikuje, więc kopia byłaby zbędna),
+//   - każda ramka serii ma TTL 1 (węzeł, który zapomniał MID, nie puści jej
+//     ponownie w sieć).
+// Model bez strat: łączność rodzic–dzieci pełna, ramka dociera od razu do
+// dzieci z włączonym radiem. Kod wyjścia 0 = wszystkie warunki spełnione.
+
+#include "meshDutyCycle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const int TOPICS = 4;
+static const uint16_t TOPIC_BASE = 0x100;
+static const uint32_t PUBLISH_MS = 7000;
+static const uint8_t DATA_MAGIC = 0xC1;   // jak ramka kompaktowa
+
+static uint32_t s_rand = 12345;
+static uint32_t rnd() {
+  s_rand = s_rand * 1103515245u + 12345u;
+  return s_rand >> 8;
+}
+
+// ================== RAMKI ==================
+
+// uproszczona wiadomość mesh: to, co symulacja musi odczytać z serii
+struct SimFrame {
+  uint8_t  magic;      // DATA_MAGIC
+  int8_t   ttl;
+  uint16_t topic;
+  uint32_t mid;
+  uint8_t  source[6];
+};
+
+static void macOf(int idx, uint8_t mac[6]) {
+  const uint8_t m[6] = {0x02, 0, 0, 0, uint8_t(idx >> 8), uint8_t(idx)};
+  memcpy(mac, m, 6);
+}
+
+static int indexOf(const uint8_t mac[6]) {
+  return (mac[4] << 8) | mac[5];
+}
+
+// ================== WĘZŁY ==================
+
+static const int PARENT = 1000;
+static const int OUTSIDE = 2000;           // autor wiadomości spoza zasięgu dzieci
+
+struct Child {
+  MeshDutyCycle dc;
+  uint32_t start_ms = 0;
+  bool want_all = false;
+  std::vector<uint16_t> topics;
+  uint32_t next_pub = 0;
+  bool registered = false;                 // rodzic przyjął pobudkę
+  uint64_t radio_ms = 0;
+
+  bool wants(uint16_t topic) const {
+    if (want_all) return true;
+    for (uint16_t t : topics) {
+      if (t == topic) return true;
+    }
+    return false;
+  }
+};
+
+struct Sim {
+  MeshDutyCycle parent;
+  std::vector<Child> children;
+  std::vector<uint32_t> born;              // mid → czas nadania
+  std::vector<std::vector<uint8_t>> expected, got;  // [mid][dziecko]
+  uint32_t echoes = 0, mismatches = 0, bad_ttl = 0, burst_frames = 0, max_latency = 0;
+  uint64_t latency_sum = 0, latency_n = 0;
+
+  // seria idzie broadcastem: dziecko słyszy też kopie dla innych dzieci,
+  // własne wiadomości odrzuca po MID jak MeshLib
+  void deliver(int k, const SimFrame &f, uint32_t now) {
+    if (indexOf(f.source) == k) return;
+    if (!children[k].wants(f.topic) || got[f.mid][k]) return;
+    got[f.mid][k] = 1;
+    const uint32_t lat = now - born[f.mid];
+    if (expected[f.mid][k]) {
+      if (lat > max_latency) max_latency = lat;
+      latency_sum += lat;
+      latency_n++;
+    }
+  }
+
+  // wiadomość nadana w sieci: słyszą ją rodzic i dzieci z włączonym radiem
+  void publish(int author, uint16_t topic, uint32_t now) {
+    const uint32_t mid = uint32_t(born.size());
+    born.push_back(now);
+    expected.push_back(std::vector<uint8_t>(children.size(), 0));
+    got.push_back(std::vector<uint8_t>(children.size(), 0));
+
+    SimFrame f{};
+    f.magic = DATA_MAGIC;
+    f.ttl = 5;
+    f.topic = topic;
+    f.mid = mid;
+    macOf(author, f.source);
+
+    for (size_t k = 0; k < children.size(); ++k) {
+      if (int(k) != author && children[k].dc.awake()) deliver(int(k), f, now);
+    }
+    offerSleepy(f, now);
+  }
+
+  // jak MeshLib::_offerSleepy: kopia z TTL 1, źródło = autor
+  void offerSleepy(const SimFrame &msg, uint32_t now) {
+    SimFrame copy = msg;
+    copy.ttl = 1;
+    const size_t n = parent.offer(reinterpret_cast<const uint8_t*>(&copy), sizeof(copy),
+                                  copy.topic, nullptr, copy.source, now);
+    // oczekiwani odbiorcy: dzieci znane rodzicowi z pasującą subskrypcją
+    size_t want = 0;
+    for (size_t k = 0; k < children.size(); ++k) {
+      const Child &c = children[k];
+      if (!c.registered || indexOf(copy.source) == int(k) || !c.wants(copy.topic)) continue;
+      expected[copy.mid][k] = 1;
+      ++want;
+    }
+    // autor subskrybuje własny topic, więc kopia dla niego = nadmiarowa
+    if (n > want) echoes++;
+    if (n != want) {
+      printf("  mid %u: parent buffered %zu copies, expected %zu\n", copy.mid, n, want);
+      mismatches++;
+    }
+  }
+
+  // ramka od rodzica (ACK/END albo wiadomość z serii)
+  void broadcastFromParent(const uint8_t *frame, size_t len, uint32_t now) {
+    uint8_t pmac[6];
+    macOf(PARENT, pmac);
+    if (frame[0] == MESH_DC_MAGIC) {
+      for (Child &c : children) {
+        mesh_dc_frame unused;
+        if (c.dc.awake()) (void)c.dc.onFrame(pmac, frame, len, now, unused);
+      }
+      return;
+    }
+    SimFrame f;
+    memcpy(&f, frame, sizeof(f));
+    burst_frames++;
+    if (f.ttl != 1) bad_ttl++;
+    for (size_t k = 0; k < children.size(); ++k) {
+      if (children[k].dc.awake()) deliver(int(k), f, now);
+    }
+  }
+};
+
+// ================== MAIN ==================
+
+int main(int argc, char **argv) {
+  const uint32_t period = argc > 1 ? uint32_t(atoi(argv[1])) : 2000;
+  const uint32_t window = argc > 2 ? uint32_t(atoi(argv[2])) : 30;
+  const int nchildren   = argc > 3 ? atoi(argv[3]) : 3;
+  const uint32_t gap    = argc > 4 ? uint32_t(atoi(argv[4])) : 500;
+  const uint32_t secs   = argc > 5 ? uint32_t(atoi(argv[5])) : 600;
+  if (period < 20 || window < 10 || window > 0xFFFF || nchildren < 1 ||
+      nchildren > MESH_DC_CHILDREN || gap < 1 || secs * 1000 <= 2 * period + MESH_DC_WINDOW_MAX_MS) {
+    fprintf(stderr, "usage: meshdc [period_ms=2000] [window_ms=30] [children=3 (max %d)] "
+                    "[gap_ms=500] [seconds=600]\n", MESH_DC_CHILDREN);
+    return 2;
+  }
+
+  Sim sim;
+  uint8_t mac[6];
+  macOf(PARENT, mac);
+  sim.parent.setSelf(mac);
+  sim.parent.setRole(MESH_DC_PARENT, 0);
+
+  sim.children.resize(size_t(nchildren));
+  for (int k = 0; k < nchildren; ++k) {
+    Child &c = sim.children[size_t(k)];
+    macOf(k, mac);
+    c.dc.setSelf(mac);
+    c.start_ms = rnd() % period;
+    c.next_pub = c.start_ms + PUBLISH_MS / 2 + rnd() % PUBLISH_MS;
+    c.want_all = (k == 0);
+    if (!c.want_all) {
+      c.topics.push_back(uint16_t(TOPIC_BASE + k % TOPICS));
+      c.topics.push_back(uint16_t(TOPIC_BASE + (k + 1) % TOPICS));
+    }
+    c.dc.setSchedule(period, uint16_t(window));
+    c.dc.setTopics(c.topics.empty() ? nullptr : &c.topics[0], c.topics.size(), c.want_all);
+  }
+
+  // ruch kończy się dwa okresy przed końcem — wszystko zdąży dojść
+  const uint32_t end = secs * 1000;
+  const uint32_t traffic_end = end - 2 * period - MESH_DC_WINDOW_MAX_MS;
+  uint32_t next_msg = gap;
+  uint32_t last_burst = 0;
+  uint8_t frame[MESH_DC_FRAME_MAX];
+
+  for (uint32_t now = 0; now < end; ++now) {
+    if (now < traffic_end && now >= next_msg) {
+      sim.publish(OUTSIDE, uint16_t(TOPIC_BASE + rnd() % TOPICS), now);
+      next_msg = now + gap / 2 + rnd() % gap;
+    }
+
+    for (int k = 0; k < nchildren; ++k) {
+      Child &c = sim.children[size_t(k)];
+      if (now == c.start_ms) c.dc.setRole(MESH_DC_SLEEPY, now);
+      if (c.dc.role() != MESH_DC_SLEEPY) continue;
+
+      if (now < traffic_end && now >= c.next_pub) {
+        (void)c.dc.wakeForSend(now);   // radio „włączone” od razu
+        sim.publish(k, uint16_t(TOPIC_BASE + k % TOPICS), now);
+        c.next_pub = now + PUBLISH_MS / 2 + rnd() % PUBLISH_MS;
+      }
+
+      if (c.dc.step(now) == MESH_DC_WAKE) {
+        mesh_dc_frame wake, reply;
+        c.dc.buildWake(wake);
+        macOf(k, mac);
+        if (sim.parent.onFrame(mac, reinterpret_cast<const uint8_t*>(&wake), sizeof(wake), now, reply)) {
+          c.registered = true;
+          sim.broadcastFromParent(reinterpret_cast<const uint8_t*>(&reply), sizeof(reply), now);
+        }
+      }
+      if (c.dc.awake()) c.radio_ms++;
+    }
+
+    (void)sim.parent.step(now);
+    if (now - last_burst >= MESH_DC_FRAME_MS / 2) {
+      const size_t len = sim.parent.nextBurst(now, frame);
+      if (len) {
+        last_burst = now;
+        sim.broadcastFromParent(frame, len, now);
+      }
+    }
+  }
+
+  // ================== WYNIK ==================
+
+  size_t expected = 0, missing = 0;
+  for (size_t m = 0; m < sim.expected.size(); ++m) {
+    for (int k = 0; k < nchildren; ++k) {
+      if (!sim.expected[m][size_t(k)]) continue;
+      ++expected;
+      if (!sim.got[m][size_t(k)]) ++missing;
+    }
+  }
+
+  bool ok = true;
+  const mesh_dc_stats &ps = sim.parent.stats();
+  printf("period %u ms, window %u ms, %d children, %zu messages in %u s\n",
+         period, window, nchildren, sim.born.size(), secs);
+  for (int k = 0; k < nchildren; ++k) {
+    const Child &c = sim.children[size_t(k)];
+    const double on = 100.0 * double(c.radio_ms) / double(end - c.start_ms);
+    printf("  child %d: radio on %.2f%% (window alone %.2f%%), wakes %u, acks %u\n",
+           k, on, 100.0 * window / period, c.dc.stats().wakes, c.dc.stats().acks);
+  }
+  printf("buffered %zu deliveries: %zu missing, %u dropped from full queue, %u burst frames\n",
+         expected, missing, ps.dropped, sim.burst_frames);
+  printf("latency: mean %.0f ms, max %u ms (limit %u)\n",
+         sim.latency_n ? double(sim.latency_sum) / sim.latency_n : 0.0, sim.max_latency,
+         period + MESH_DC_WINDOW_MAX_MS);
+  printf("copies buffered for their own author: %u, burst frames with TTL != 1: %u\n",
+         sim.echoes, sim.bad_ttl);
+
+  ok = ok && missing <= ps.dropped;
+  ok = ok && sim.max_latency <= period + MESH_DC_WINDOW_MAX_MS;
+  ok = ok && sim.echoes == 0 && sim.mismatches == 0 && sim.bad_ttl == 0;
+  ok = ok && ps.children_lost == 0;
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
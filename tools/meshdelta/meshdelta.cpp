@@ -0,0 +1,261 @@
+// meshdelta — generator i aplikator łatek firmware dla OTA delta (host).
+//
+//   g++ -O2 -std=c++11 -Iinclude tools/meshdelta/meshdelta.cpp src/meshDelta.cpp -o meshdelta
+//
+//   meshdelta diff  <stary.bin> <nowy.bin> <latka.mdl>
+//   meshdelta apply <stary.bin> <latka.mdl> <wynik.bin>   (jak na urządzeniu)
+//   meshdelta hash  <plik>
+//
+// "apply" używa tego samego MeshDeltaApplier co firmware, z partycjami
+// w plikach, więc łatkę można sprawdzić przed wysłaniem.
+
+#include "meshDelta.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// ================== PLIKI ==================
+
+static bool readFile(const char *path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static bool writeFile(const char *path, const std::vector<uint8_t> &data) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return fclose(f) == 0 && ok;
+}
+
+static void sha256(const std::vector<uint8_t> &data, uint8_t out[MESH_DELTA_HASH_LEN]) {
+  MeshSha256 sha;
+  sha.update(data.data(), data.size());
+  sha.finish(out);
+}
+
+// ================== GENERATOR ==================
+
+static const size_t MIN_MATCH = 16;   // krótsza kopia nie opłaca się (nagłówek op)
+static const int HASH_BITS = 20;
+static const int MAX_CHAIN = 64;
+
+static uint32_t windowHash(const uint8_t *p) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < 8; ++i) h = (h ^ p[i]) * 16777619u;
+  return h >> (32 - HASH_BITS);
+}
+
+static void putVarint(std::vector<uint8_t> &out, uint32_t v) {
+  while (v >= 0x80) {
+    out.push_back(uint8_t(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(uint8_t(v));
+}
+
+static size_t matchLen(const std::vector<uint8_t> &a, size_t ai,
+                       const std::vector<uint8_t> &b, size_t bi) {
+  size_t n = 0;
+  while (ai + n < a.size() && bi + n < b.size() && a[ai + n] == b[bi + n]) ++n;
+  return n;
+}
+
+static void emitLiteral(std::vector<uint8_t> &out, const std::vector<uint8_t> &nw,
+                        size_t from, size_t to) {
+  if (to <= from) return;
+  putVarint(out, uint32_t(to - from) << 1 | 1);
+  out.insert(out.end(), nw.begin() + from, nw.begin() + to);
+}
+
+static std::vector<uint8_t> makeDelta(const std::vector<uint8_t> &old,
+                                      const std::vector<uint8_t> &nw,
+                                      size_t &copied) {
+  mesh_delta_header hdr;
+  hdr.old_size = uint32_t(old.size());
+  hdr.new_size = uint32_t(nw.size());
+  sha256(old, hdr.old_hash);
+  sha256(nw, hdr.new_hash);
+
+  std::vector<uint8_t> out(MESH_DELTA_HEADER_LEN);
+  MeshDeltaApplier::writeHeader(hdr, out.data());
+
+  // indeks 8-bajtowych okien starego obrazu (łańcuchy od najnowszego)
+  std::vector<int32_t> head(size_t(1) << HASH_BITS, -1);
+  std::vector<int32_t> prev(old.size(), -1);
+  for (size_t i = 0; i + 8 <= old.size(); ++i) {
+    const uint32_t h = windowHash(&old[i]);
+    prev[i] = head[h];
+    head[h] = int32_t(i);
+  }
+
+  size_t lit_start = 0;
+  size_t i = 0;
+  uint32_t copy_end = 0;   // koniec poprzedniej kopii w starym obrazie
+  copied = 0;
+  while (i + 8 <= nw.size()) {
+    // najpierw kontynuacja poprzedniego dopasowania (kod przesunięty w całości)
+    size_t best_len = 0;
+    size_t best_pos = 0;
+    const size_t expect = copy_end + (i - lit_start);
+    if (expect < old.size()) {
+      best_len = matchLen(old, expect, nw, i);
+      best_pos = expect;
+    }
+    int chain = 0;
+    for (int32_t c = head[windowHash(&nw[i])]; c >= 0 && chain < MAX_CHAIN; c = prev[c], ++chain) {
+      const size_t n = matchLen(old, size_t(c), nw, i);
+      if (n > best_len) {
+        best_len = n;
+        best_pos = size_t(c);
+      }
+    }
+
+    if (best_len < MIN_MATCH) {
+      ++i;
+      continue;
+    }
+
+    emitLiteral(out, nw, lit_start, i);
+    putVarint(out, uint32_t(best_len) << 1);
+    const int32_t off = int32_t(int64_t(best_pos) - int64_t(copy_end));
+    putVarint(out, uint32_t((off << 1) ^ (off >> 31)));
+    copy_end = uint32_t(best_pos + best_len);
+    copied += best_len;
+    i += best_len;
+    lit_start = i;
+  }
+  emitLiteral(out, nw, lit_start, nw.size());
+  return out;
+}
+
+// ================== APLIKATOR NA PLIKACH ==================
+
+class FileSource : public MeshDeltaSource {
+public:
+  explicit FileSource(const std::vector<uint8_t> &data) : _data(data) {}
+  uint32_t size() const override { return uint32_t(_data.size()); }
+  bool read(uint32_t offset, uint8_t *buf, size_t len) override {
+    if (size_t(offset) + len > _data.size()) return false;
+    memcpy(buf, &_data[offset], len);
+    return true;
+  }
+
+private:
+  const std::vector<uint8_t> &_data;
+};
+
+class FileSink : public MeshDeltaSink {
+public:
+  explicit FileSink(const char *path) : _path(path) {}
+  bool begin(uint32_t size) override {
+    _data.clear();
+    _data.reserve(size);
+    return true;
+  }
+  bool write(const uint8_t *buf, size_t len) override {
+    _data.insert(_data.end(), buf, buf + len);
+    return true;
+  }
+  bool end(bool commit) override {
+    // jak partycja OTA: bez commitu nic nie staje się obrazem
+    return commit ? writeFile(_path, _data) : true;
+  }
+
+private:
+  const char *_path;
+  std::vector<uint8_t> _data;
+};
+
+static MeshDeltaResult applyDelta(const std::vector<uint8_t> &old,
+                                  const std::vector<uint8_t> &patch, const char *out_path) {
+  FileSource src(old);
+  FileSink dst(out_path);
+  MeshDeltaApplier applier;
+  applier.begin(src, dst);
+
+  // porcje jak z gniazda TCP
+  size_t pos = 0;
+  MeshDeltaResult r = MESH_DELTA_MORE;
+  while (r == MESH_DELTA_MORE) {
+    size_t want = applier.wants();
+    if (want == 0) {
+      r = applier.poll();
+      continue;
+    }
+    if (pos >= patch.size()) {
+      applier.abort();
+      return MESH_DELTA_ERR_FORMAT; // łatka urwana
+    }
+    if (want > 1460) want = 1460;
+    if (want > patch.size() - pos) want = patch.size() - pos;
+    r = applier.feed(&patch[pos], want);
+    pos += want;
+  }
+  return r;
+}
+
+// ================== MAIN ==================
+
+static int usage() {
+  fprintf(stderr,
+          "usage: meshdelta diff <old.bin> <new.bin> <patch.mdl>\n"
+          "       meshdelta apply <old.bin> <patch.mdl> <out.bin>\n"
+          "       meshdelta hash <file>\n");
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) return usage();
+
+  if (strcmp(argv[1], "hash") == 0) {
+    std::vector<uint8_t> data;
+    if (!readFile(argv[2], data)) { perror(argv[2]); return 1; }
+    uint8_t h[MESH_DELTA_HASH_LEN];
+    sha256(data, h);
+    for (size_t i = 0; i < sizeof(h); ++i) printf("%02x", h[i]);
+    printf("  %s\n", argv[2]);
+    return 0;
+  }
+
+  if (argc != 5) return usage();
+  std::vector<uint8_t> a, b;
+  if (!readFile(argv[2], a)) { perror(argv[2]); return 1; }
+  if (!readFile(argv[3], b)) { perror(argv[3]); return 1; }
+
+  if (strcmp(argv[1], "diff") == 0) {
+    size_t copied = 0;
+    const std::vector<uint8_t> patch = makeDelta(a, b, copied);
+    if (!writeFile(argv[4], patch)) { perror(argv[4]); return 1; }
+    printf("%zu -> %zu bytes, patch %zu bytes (%.1f%%), %zu bytes copied\n",
+           a.size(), b.size(), patch.size(), 100.0 * patch.size() / (b.empty() ? 1 : b.size()), copied);
+
+    // samosprawdzenie tym samym kodem co na urządzeniu
+    const std::string tmp = std::string(argv[4]) + ".check";
+    const MeshDeltaResult r = applyDelta(a, patch, tmp.c_str());
+    std::vector<uint8_t> check;
+    const bool same = r == MESH_DELTA_OK && readFile(tmp.c_str(), check) && check == b;
+    remove(tmp.c_str());
+    if (!same) {
+      fprintf(stderr, "self-check failed: %s\n", MeshDeltaApplier::resultName(r));
+      return 1;
+    }
+    return 0;
+  }
+
+  if (strcmp(argv[1], "apply") == 0) {
+    const MeshDeltaResult r = applyDelta(a, b, argv[4]);
+    printf("%s\n", MeshDeltaApplier::resultName(r));
+    return r == MESH_DELTA_OK ? 0 : 1;
+  }
+
+  return usage();
+}
@@ -0,0 +1,234 @@
+// meshdict — budowa słownika wstępnego MeshLz i pomiar kompresji (host).
+//
+//   g++ -O2 -std=c++11 -Iinclude tools/meshdict/meshdict.cpp src/meshCompress.cpp -o meshdict
+//
+//   meshdict build <korpus.txt> <meshCompressDict.h> [rozmiar=512]
+//   meshdict bench <korpus.txt> [odłożony.txt]
+//
+// Korpus: jeden payload na linię (puste linie pomijane). "build" wybiera
+// najczęstsze podciągi korpusu i zapisuje nagłówek do include/; "bench"
+// kompresuje każdą linię tym samym kodem co firmware, sprawdza round-trip
+// i wypisuje stopień kompresji. Wynik na korpusie, z którego zbudowano
+// słownik, jest zawyżony — miarodajny jest odłożony korpus (te same formaty,
+// inne wartości, plus payloady spoza korpusu), np. tools/meshdict/heldout.txt.
+// Po zmianie słownika przebuduj narzędzie i uruchom bench ponownie.
+
+#include "meshCompress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+static const size_t PAYLOAD_MAX = 139;   // standard_mesh_message::payload bez '\0'
+static const size_t CF_HEADER = 16;      // nagłówek ramki kompaktowej
+
+// ================== KORPUS ==================
+
+static bool readLines(const char *path, std::vector<std::string> &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  char buf[1024];
+  while (fgets(buf, sizeof(buf), f)) {
+    size_t n = strlen(buf);
+    while (n && (buf[n - 1] == '\n' || buf[n - 1] == '\r')) buf[--n] = '\0';
+    if (n == 0) continue;
+    if (n > PAYLOAD_MAX) n = PAYLOAD_MAX;   // jak strncpy w sendMessage
+    out.push_back(std::string(buf, n));
+  }
+  fclose(f);
+  return true;
+}
+
+// ================== BUDOWA SŁOWNIKA ==================
+
+// Wybór jak w algorytmie COVER (zstd): segment korpusu jest tyle wart, ile
+// jeszcze niepokrytych k-merów zawiera (ważonych liczbą linii z k-merem);
+// po wybraniu jego k-mery przestają się liczyć, więc warianty tego samego
+// tekstu nie zjadają słownika.
+static const size_t KMER = 6;
+static const size_t SEGMENT = 32;
+
+static std::string buildDict(const std::vector<std::string> &lines, size_t size) {
+  // liczba linii z danym k-merem (powtórzenia w linii pokrywa już samo LZ,
+  // słownik ma pomóc pierwszemu wystąpieniu)
+  std::map<std::string, int> freq;
+  for (const std::string &line : lines) {
+    std::set<std::string> seen;
+    for (size_t i = 0; i + KMER <= line.size(); ++i) seen.insert(line.substr(i, KMER));
+    for (const std::string &k : seen) freq[k]++;
+  }
+  for (auto &kv : freq) {
+    if (kv.second < 2) kv.second = 0;   // unikaty (MAC, liczby) nic nie dadzą
+  }
+
+  std::string dict;
+  while (dict.size() < size) {
+    long best = 0;
+    const std::string *best_line = nullptr;
+    size_t best_pos = 0, best_len = 0;
+    for (const std::string &line : lines) {
+      for (size_t i = 0; i + KMER <= line.size(); ++i) {
+        const size_t len = std::min(SEGMENT, line.size() - i);
+        std::set<std::string> in_seg;
+        long score = 0;
+        for (size_t j = i; j + KMER <= i + len; ++j) {
+          const std::string k = line.substr(j, KMER);
+          if (in_seg.insert(k).second) score += freq[k];
+        }
+        if (score > best) {
+          best = score;
+          best_line = &line;
+          best_pos = i;
+          best_len = len;
+        }
+      }
+    }
+    if (!best_line) break;
+
+    // przycięcie końców bez wartości
+    std::string seg = best_line->substr(best_pos, best_len);
+    while (seg.size() > KMER && freq[seg.substr(0, KMER)] == 0) seg.erase(0, 1);
+    while (seg.size() > KMER && freq[seg.substr(seg.size() - KMER)] == 0) seg.erase(seg.size() - 1);
+    for (size_t j = 0; j + KMER <= seg.size(); ++j) freq[seg.substr(j, KMER)] = 0;
+
+    if (dict.find(seg) != std::string::npos) continue;
+    // sklejenie z końcem słownika, jeśli się nakładają
+    size_t overlap = std::min(dict.size(), seg.size() - 1);
+    while (overlap && dict.compare(dict.size() - overlap, overlap, seg, 0, overlap) != 0) --overlap;
+    if (dict.size() + seg.size() - overlap > size) break;
+    dict += seg.substr(overlap);
+  }
+  return dict;
+}
+
+static bool writeHeader(const char *path, const char *corpus, const std::string &dict) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  fprintf(f,
+          "#pragma once\n"
+          "\n"
+          "// Słownik wstępny MeshLz (%zu B) — wygenerowany, nie edytuj ręcznie:\n"
+          "//   meshdict build %s <ten plik>\n"
+          "// Zmiana słownika zmienia format skompresowanych ramek: wszystkie węzły\n"
+          "// w sieci muszą mieć ten sam.\n"
+          "\n"
+          "static const char MESH_LZ_DICT[] PROGMEM =\n",
+          dict.size(), corpus);
+  for (size_t i = 0; i < dict.size(); i += 64) {
+    fputs("  \"", f);
+    for (size_t k = i; k < dict.size() && k < i + 64; ++k) {
+      const unsigned char ch = (unsigned char)dict[k];
+      if (ch == '"' || ch == '\\') fprintf(f, "\\%c", ch);
+      else if (ch < 0x20 || ch >= 0x7F) fprintf(f, "\\%03o", ch);
+      else fputc(ch, f);
+    }
+    fputs(i + 64 >= dict.size() ? "\";\n" : "\"\n", f);
+  }
+
+  // indeks dla kompresora: ostatnia pozycja każdego bajtu i łańcuch
+  // poprzednich pozycji z tym samym bajtem (0xFFFF = koniec)
+  std::vector<uint16_t> head(256, 0xFFFF), prev(dict.size(), 0xFFFF);
+  for (size_t i = 0; i < dict.size(); ++i) {
+    const unsigned char ch = (unsigned char)dict[i];
+    prev[i] = head[ch];
+    head[ch] = uint16_t(i);
+  }
+  const std::vector<uint16_t> *tables[2] = {&head, &prev};
+  const char *names[2] = {"MESH_LZ_DICT_HEAD", "MESH_LZ_DICT_PREV"};
+  fputs("\n// Indeks pozycji według pierwszego bajtu (0xFFFF = koniec łańcucha)\n", f);
+  for (int t = 0; t < 2; ++t) {
+    const std::vector<uint16_t> &v = *tables[t];
+    fprintf(f, "static const uint16_t %s[%zu] PROGMEM = {\n", names[t], v.size());
+    for (size_t i = 0; i < v.size(); ++i) {
+      fprintf(f, "%s0x%04X,%s", i % 12 == 0 ? "  " : "", v[i],
+              (i % 12 == 11 || i + 1 == v.size()) ? "\n" : " ");
+    }
+    fputs("};\n", f);
+  }
+  return fclose(f) == 0;
+}
+
+// ================== BENCH ==================
+
+static int bench(const char *label, const std::vector<std::string> &lines) {
+  size_t raw = 0, packed = 0, compressed_lines = 0, failures = 0;
+  size_t frame_raw = 0, frame_packed = 0;
+  for (const std::string &line : lines) {
+    const uint8_t *in = reinterpret_cast<const uint8_t*>(line.data());
+    uint8_t enc[2 * PAYLOAD_MAX + 2];
+    uint8_t dec[PAYLOAD_MAX + 1];
+
+    // round-trip bez limitu (sprawdza też dane, które się nie kompresują)
+    const size_t full = MeshLz::compress(in, line.size(), enc, sizeof(enc));
+    size_t out_len = 0;
+    if (!full || !MeshLz::decompress(enc, full, dec, PAYLOAD_MAX, out_len) ||
+        out_len != line.size() || memcmp(dec, in, out_len) != 0) {
+      fprintf(stderr, "round-trip FAILED: %s\n", line.c_str());
+      ++failures;
+      continue;
+    }
+
+    // jak w ramce: kompresja tylko gdy krótsza
+    const size_t n = MeshLz::compress(in, line.size(), enc, line.size() - 1);
+    const size_t sent = n ? n : line.size();
+    if (n) ++compressed_lines;
+    raw += line.size();
+    packed += sent;
+    frame_raw += CF_HEADER + line.size();
+    frame_packed += CF_HEADER + sent;
+  }
+
+  printf("%s\n", label);
+  printf("payloads    %zu (%zu compressed, %zu round-trip failures)\n",
+         lines.size(), compressed_lines, failures);
+  printf("payload     %zu -> %zu B (%.1f%%)\n", raw, packed, raw ? 100.0 * packed / raw : 0.0);
+  printf("frame       %zu -> %zu B (%.1f%%)\n", frame_raw, frame_packed,
+         frame_raw ? 100.0 * frame_packed / frame_raw : 0.0);
+  return failures ? 1 : 0;
+}
+
+// ================== MAIN ==================
+
+static int usage() {
+  fprintf(stderr,
+          "usage: meshdict build <corpus.txt> <out.h> [size]\n"
+          "       meshdict bench <corpus.txt> [held_out.txt]\n");
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) return usage();
+  std::vector<std::string> lines;
+  if (!readLines(argv[2], lines)) { perror(argv[2]); return 1; }
+
+  if (strcmp(argv[1], "build") == 0 && (argc == 4 || argc == 5)) {
+    const size_t size = argc == 5 ? size_t(atoi(argv[4])) : 512;
+    if (size == 0 || size + 255 > MESH_LZ_MAX_DIST) {
+      fprintf(stderr, "size must be 1..%d\n", MESH_LZ_MAX_DIST - 255);
+      return 2;
+    }
+    const std::string dict = buildDict(lines, size);
+    if (!writeHeader(argv[3], argv[2], dict)) { perror(argv[3]); return 1; }
+    printf("%zu lines -> %zu byte dictionary in %s\n", lines.size(), dict.size(), argv[3]);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "bench") == 0 && (argc == 3 || argc == 4)) {
+    printf("dictionary  %zu B\n", MeshLz::dictSize());
+    int r = bench(argv[2], lines);
+    if (argc == 4) {
+      std::vector<std::string> held;
+      if (!readLines(argv[3], held)) { perror(argv[3]); return 1; }
+      printf("\n");
+      r |= bench(argv[3], held);
+    }
+    return r;
+  }
+
+  return usage();
+}
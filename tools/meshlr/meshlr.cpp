@@ -0,0 +1,294 @@
+// meshlr — test polityki rate/mocy MeshLinkRate (host).
+//
+//   g++ -O2 -std=c++11 -Iinclude tools/meshlr/meshlr.cpp src/meshLinkRate.cpp -o meshlr
+//
+//   meshlr [strata_%=10] [wiadomości=2000]
+//
+// Najpierw stałe scenariusze (wybór rate po RSSI, najsłabszy sąsiad, sąsiad
+// nieaktualny, kara za stratę i powrót, liść szkieletu bez ech, sąsiad, który
+// przestał forwardować, echo w ramce XOR, wymiana slotu sąsiada, obniżanie
+// mocy). Potem symulacja: własne broadcasty co 100 ms, sąsiad forwarduje każdy,
+// echo ginie z prawdopodobieństwem strata_%, expire() co 10 ms jak z loop().
+// Zmierzony odsetek strat powinien odpowiadać zadanemu. Kod wyjścia 0 =
+// wszystkie scenariusze poprawne.
+
+#include "meshLinkRate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static uint32_t s_rand = 12345;
+static uint32_t rnd() {
+  s_rand = s_rand * 1103515245u + 12345u;
+  return s_rand >> 8;
+}
+
+static void macOf(int idx, uint8_t mac[6]) {
+  const uint8_t m[6] = {0x02, 0, 0, 0, uint8_t(idx >> 8), uint8_t(idx)};
+  memcpy(mac, m, 6);
+}
+
+static bool info(const MeshLinkRate &lr, int idx, mesh_link_info &out) {
+  uint8_t mac[6];
+  macOf(idx, mac);
+  for (size_t i = 0; i < MeshLinkRate::neighborCapacity(); ++i) {
+    if (lr.neighborAt(i, out) && memcmp(out.mac, mac, 6) == 0) return true;
+  }
+  return false;
+}
+
+static bool s_ok = true;
+
+static void check(const char *name, bool ok) {
+  printf("%-34s %s\n", name, ok ? "ok" : "FAIL");
+  s_ok = s_ok && ok;
+}
+
+// jeden broadcast: echa od sąsiadów z echo[i] = true, potem upływ okna
+static void broadcast(MeshLinkRate &lr, uint32_t mid, uint32_t &now, const bool *echo, int n) {
+  lr.onBroadcast(mid, now);
+  for (int i = 0; i < n; ++i) {
+    if (!echo[i]) continue;
+    uint8_t mac[6];
+    macOf(i, mac);
+    lr.onRssi(mac, -60, now + 5);
+    lr.onEcho(mac, mid, now + 5);
+  }
+  now += MESH_LINK_ECHO_MS;
+  lr.expire(now);
+}
+
+// ================== SCENARIUSZE ==================
+
+static void rssiChoice() {
+  const struct { int8_t rssi; bool lr; MeshPhyRate want; } cases[] = {
+    { -60, false, MESH_PHY_54M },
+    { -72, false, MESH_PHY_36M },
+    { -80, false, MESH_PHY_12M },
+    { -86, false, MESH_PHY_2M },
+    { -95, false, MESH_PHY_1M },     // brak zapasu — najwolniejszy dozwolony
+    { -95, true,  MESH_PHY_LR_250K },
+  };
+  bool ok = true;
+  for (const auto &c : cases) {
+    MeshLinkRate lr;
+    mesh_link_config cfg = lr.config();
+    cfg.allow_lr = c.lr;
+    lr.setConfig(cfg);
+    uint8_t mac[6];
+    macOf(1, mac);
+    lr.onRssi(mac, c.rssi, 0);
+    const mesh_link_choice got = lr.selectBroadcast(0);
+    if (got.rate != c.want) {
+      printf("  rssi %d lr %d: rate %u, expected %u\n", c.rssi, c.lr, got.rate, c.want);
+      ok = false;
+    }
+  }
+  check("rate from RSSI", ok);
+}
+
+static void weakestAndStale() {
+  MeshLinkRate lr;
+  uint8_t a[6], b[6];
+  macOf(1, a);
+  macOf(2, b);
+  lr.onRssi(a, -60, 0);
+  lr.onRssi(b, -80, 0);
+  check("weakest neighbour decides", lr.selectBroadcast(0).rate == MESH_PHY_12M);
+
+  lr.onRssi(a, -60, MESH_LINK_STALE_MS + 1000);
+  check("stale neighbour ignored", lr.selectBroadcast(MESH_LINK_STALE_MS + 1000).rate == MESH_PHY_54M);
+
+  MeshLinkRate empty;
+  check("no neighbours -> fallback", empty.selectBroadcast(0).rate == empty.config().fallback);
+}
+
+static void lossAndRecover() {
+  MeshLinkRate lr;
+  uint32_t now = 0, mid = 0;
+  const bool yes = true, no = false;
+  broadcast(lr, ++mid, now, &yes, 1);  // pierwsze echo: odtąd oczekiwany
+  broadcast(lr, ++mid, now, &no, 1);   // strata
+  mesh_link_info n{};
+  info(lr, 0, n);
+  const bool penalised = n.penalty == 1 && n.tx_fail == 1 &&
+                         lr.selectBroadcast(now).rate == MESH_PHY_48M;
+  check("missing echo costs one step", penalised);
+
+  for (int i = 0; i < MESH_LINK_RECOVER_SUCCESSES; ++i) broadcast(lr, ++mid, now, &yes, 1);
+  info(lr, 0, n);
+  check("echo streak restores the step", n.penalty == 0 && lr.selectBroadcast(now).rate == MESH_PHY_54M);
+}
+
+static void silentNeighbours() {
+  // liść szkieletu: słyszany, ale nigdy nie forwarduje
+  MeshLinkRate lr;
+  uint8_t leaf[6];
+  macOf(0, leaf);
+  uint32_t now = 0, mid = 0;
+  const bool no = false, yes = true;
+  for (int i = 0; i < 50; ++i) {
+    lr.onRssi(leaf, -60, now);
+    broadcast(lr, ++mid, now, &no, 1);
+  }
+  mesh_link_info n{};
+  info(lr, 0, n);
+  check("non-forwarder never penalised", n.penalty == 0 && n.tx_fail == 0);
+
+  // forwardował, potem przestał (np. zmiana MPR): jedna kara, nie 50
+  MeshLinkRate lr2;
+  now = 0;
+  broadcast(lr2, ++mid, now, &yes, 1);
+  for (int i = 0; i < 50; ++i) {
+    lr2.onRssi(leaf, -60, now);
+    broadcast(lr2, ++mid, now, &no, 1);
+  }
+  info(lr2, 0, n);
+  check("stopped forwarder penalised once", n.penalty == 1 && n.tx_fail == 1);
+}
+
+// relay przekazuje co drugą naszą wiadomość w ramce XOR: MeshLib liczy ją
+// jako echo, gdy awaiting(mid) — bez tego każda para to strata
+static void codedEcho() {
+  MeshLinkRate with, without;
+  uint8_t relay[6];
+  macOf(0, relay);
+  uint32_t now = 0;
+  bool awaited = true;
+  for (uint32_t mid = 1; mid <= 100; ++mid) {
+    with.onBroadcast(mid, now);
+    without.onBroadcast(mid, now);
+    with.onRssi(relay, -60, now + 5);
+    without.onRssi(relay, -60, now + 5);
+    if (mid % 2) {
+      with.onEcho(relay, mid, now + 5);
+      without.onEcho(relay, mid, now + 5);
+    } else {
+      // ramka XOR: mid_a = nasz, mid_b = cudzy
+      awaited = awaited && with.awaiting(mid) && !with.awaiting(mid + 1000);
+      if (with.awaiting(mid)) with.onEcho(relay, mid, now + 5);
+    }
+    now += MESH_LINK_ECHO_MS;
+    with.expire(now);
+    without.expire(now);
+  }
+  mesh_link_info a{}, b{};
+  info(with, 0, a);
+  info(without, 0, b);
+  check("coded frame counts as echo", awaited && a.penalty == 0 && a.tx_fail == 0 && b.tx_fail > 0);
+  check("awaiting ends after echo window", !with.awaiting(100));
+}
+
+static void eviction() {
+  MeshLinkRate lr;
+  uint32_t now = 0;
+  const int n = int(MeshLinkRate::neighborCapacity());
+  bool echo[MESH_LINK_MAX_NEIGHBORS + 1];
+  for (int i = 0; i <= n; ++i) echo[i] = true;
+  broadcast(lr, 1, now, echo, n);  // wszyscy oczekiwani
+  lr.onBroadcast(2, now);
+  // nowy sąsiad zajmuje slot najdawniej słyszanego — nie dziedziczy oczekiwania
+  uint8_t mac[6];
+  macOf(n, mac);
+  lr.onRssi(mac, -60, now + 50);
+  for (int i = 1; i < n; ++i) {
+    macOf(i, mac);
+    lr.onEcho(mac, 2, now + 5);
+  }
+  now += MESH_LINK_ECHO_MS;
+  lr.expire(now);
+  mesh_link_info ni{};
+  const bool fresh = info(lr, n, ni) && ni.tx_fail == 0;
+  check("evicted slot loses pending echoes", fresh);
+}
+
+static void power() {
+  MeshLinkRate lr;
+  mesh_link_config cfg = lr.config();
+  cfg.adapt_power = true;
+  lr.setConfig(cfg);
+  uint8_t mac[6];
+  macOf(0, mac);
+  lr.onRssi(mac, -60, 0);
+  // 54M: zapas -60 - 3 - (-69) = 6 dB → 24 kroki po 0.25 dBm mniej
+  const mesh_link_choice c = lr.selectBroadcast(0);
+  MeshLinkRate near;
+  near.setConfig(cfg);
+  near.onRssi(mac, -20, 0);
+  const mesh_link_choice floor = near.selectBroadcast(0);
+  check("power backs off at max rate", c.power_q == cfg.max_power_q - 24 && floor.power_q == cfg.min_power_q);
+}
+
+// ================== SYMULACJA STRAT ==================
+
+static bool simulate(int loss_pct, int messages) {
+  MeshLinkRate lr;
+  uint8_t relay[6];
+  macOf(0, relay);
+  uint32_t now = 0;
+  uint32_t next_tx = 0, echo_at = 0, echo_mid = 0;
+  uint64_t kbps_sum = 0;
+  uint32_t penalty_sum = 0, sent = 0, lost = 0;
+
+  while (sent < uint32_t(messages) || echo_mid) {
+    if (sent < uint32_t(messages) && now >= next_tx) {
+      ++sent;
+      kbps_sum += lr.selectBroadcast(now).kbps;
+      lr.onBroadcast(sent, now);
+      if (int(rnd() % 100) >= loss_pct) {
+        echo_mid = sent;
+        echo_at = now + 5 + rnd() % 40;   // backoff forwardu sąsiada
+      } else {
+        ++lost;
+      }
+      next_tx = now + 100;
+    }
+    if (echo_mid && now >= echo_at) {
+      lr.onRssi(relay, -60, now);
+      lr.onEcho(relay, echo_mid, now);
+      echo_mid = 0;
+    }
+    now += 10;
+    lr.expire(now);
+    mesh_link_info n{};
+    if (info(lr, 0, n)) penalty_sum += n.penalty;
+  }
+  now += MESH_LINK_ECHO_MS;
+  lr.expire(now);
+
+  mesh_link_info n{};
+  info(lr, 0, n);
+  const uint32_t judged = uint32_t(n.tx_ok) + n.tx_fail;
+  const double measured = judged ? 100.0 * n.tx_fail / judged : 0.0;
+  printf("loss %d%%: %u sent, %u echoes lost, judged %u ok / %u fail (%.1f%%), "
+         "mean penalty %.2f, mean rate %.0f kbps\n",
+         loss_pct, sent, lost, n.tx_ok, n.tx_fail, measured,
+         double(penalty_sum) / (now / 10), double(kbps_sum) / sent);
+  // strata zaraz po stracie nie jest liczona (sąsiad przestał być oczekiwany)
+  // → oczekiwany odsetek p / (1 + p)
+  const double expected = 100.0 * loss_pct / (100.0 + loss_pct);
+  return fabs(measured - expected) < 3.0 && (loss_pct > 0 || n.penalty == 0);
+}
+
+// ================== MAIN ==================
+
+int main(int argc, char **argv) {
+  const int loss = argc > 1 ? atoi(argv[1]) : 10;
+  const int messages = argc > 2 ? atoi(argv[2]) : 2000;
+  if (loss < 0 || loss >= 100 || messages < 1) {
+    fprintf(stderr, "usage: meshlr [loss_pct=10] [messages=2000]\n");
+    return 2;
+  }
+
+  rssiChoice();
+  weakestAndStale();
+  lossAndRecover();
+  silentNeighbours();
+  codedEcho();
+  eviction();
+  power();
+  check("measured loss matches channel", simulate(loss, messages));
+  return s_ok ? 0 : 1;
+}
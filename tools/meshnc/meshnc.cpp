@@ -0,0 +1,256 @@
+// meshnc — symulacja network coding na łańcuchu relayów (host).
+//
+//   g++ -O2 -std=c++11 -Iinclude tools/meshnc/meshnc.cpp src/meshNetCoding.cpp src/meshRateLimit.cpp -o meshnc
+//
+//   meshnc [węzły=5] [wiadomości=200] [odstęp_ms=20] [payload=40] [legacy=0]
+//
+// Końce łańcucha wysyłają naprzemiennie wiadomości do siebie nawzajem
+// (telemetria w jedną stronę, komendy w drugą); każdy węzeł słyszy tylko
+// sąsiadów. Relaye działają jak MeshLib z setNetworkCoding(true): forward
+// czeka MESH_NC_HOLD_MS + jitter, para wiadomości idzie jedną ramką XOR,
+// gdy MeshNetCoder::canCombine na to pozwala i ramka XOR jest krótsza
+// w airtime niż dwie osobne. Ten sam ruch jest liczony bez kodowania
+// (forward po backoffie 1–4 ms). Model bez strat i kolizji: wynik to liczba
+// transmisji i airtime, nie przepustowość kanału.
+
+#include "meshNetCoding.h"
+#include "meshRateLimit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// układ standard_mesh_message (meshLib.h) bez ttl/mid — to, co idzie przez XOR
+struct Body {
+  char sender[18];
+  char type[16];
+  char topic[64];
+  char payload[140];
+};
+static_assert(sizeof(Body) == MESH_NC_BODY_LEN, "Body must match standard_mesh_message");
+
+static const uint32_t HOLD_MS = 15;             // MESH_NC_HOLD_MS
+static const size_t QUEUE = 4;                  // MESH_NC_QUEUE
+static const size_t CF_HEADER = 16;             // nagłówek ramki kompaktowej
+static const size_t LEGACY_LEN = 244;           // sizeof(standard_mesh_message)
+static const uint32_t RATE_KBPS = 1000;
+
+static uint32_t s_rand = 12345;
+static uint32_t rnd() {
+  s_rand = s_rand * 1103515245u + 12345u;
+  return s_rand >> 8;
+}
+
+// ================== MODEL ==================
+
+struct Msg {
+  Body     body;
+  uint32_t mid;
+  int      ttl;
+};
+
+struct Pending {
+  Msg      msg;
+  uint32_t due;
+};
+
+struct Tx {                 // ramka w locie: dociera do sąsiadów w następnej ms
+  int      from;
+  bool     coded;
+  Msg      a;               // plain: wiadomość; coded: ramka w a.body + nagłówek
+  mesh_coded_frame frame;
+  size_t   frame_len;
+};
+
+struct Node {
+  MeshNetCoder coder;
+  std::vector<uint32_t> seen;
+  std::vector<Pending> queue;
+  uint8_t mac[6];
+};
+
+struct Result {
+  size_t tx_plain = 0, tx_coded = 0;
+  uint64_t airtime_us = 0;
+  size_t delivered = 0, expected = 0, undecodable = 0;
+};
+
+static bool legacy_frames = false;
+
+static size_t frameLen(const Msg &m) {
+  return legacy_frames ? LEGACY_LEN : CF_HEADER + strnlen(m.body.payload, sizeof(m.body.payload));
+}
+
+static void macOf(int idx, uint8_t mac[6]) {
+  const uint8_t m[6] = {0x02, 0, 0, 0, 0, uint8_t(idx)};
+  memcpy(mac, m, 6);
+}
+
+static int originOf(const Msg &m) {
+  return atoi(m.body.sender + 15);   // "02:00:00:00:00:NN"
+}
+
+static bool seen(Node &n, uint32_t mid) {
+  for (uint32_t s : n.seen) if (s == mid) return true;
+  return false;
+}
+
+static Result simulate(int nodes, int messages, uint32_t interval, size_t payload, bool coding) {
+  std::vector<Node> net(nodes);
+  for (int i = 0; i < nodes; ++i) macOf(i, net[i].mac);
+  s_rand = 12345;
+
+  Result res;
+  std::vector<Tx> air, next_air;
+  uint32_t mid_seq = 1;
+  const uint32_t end = uint32_t(messages) * interval + 2000;
+
+  auto send = [&](int from, const Tx &tx) {
+    next_air.push_back(tx);
+    next_air.back().from = from;
+    res.airtime_us += MeshRateLimiter::airtimeUs(tx.coded ? tx.frame_len : frameLen(tx.a), RATE_KBPS);
+    (tx.coded ? res.tx_coded : res.tx_plain)++;
+  };
+
+  // nowa wiadomość w węźle: dedup, cache, forward
+  auto accept = [&](int at, int from, const Msg &m, uint32_t now) {
+    Node &n = net[at];
+    if (coding) {
+      uint8_t mac[6];
+      macOf(from, mac);
+      n.coder.onHeard(mac, m.mid, now);
+      macOf(originOf(m), mac);
+      n.coder.onHeard(mac, m.mid, now);
+    }
+    if (seen(n, m.mid)) return;
+    n.seen.push_back(m.mid);
+    if (coding) n.coder.remember(m.mid, reinterpret_cast<const uint8_t*>(&m.body));
+    if ((at == 0 || at == nodes - 1) && originOf(m) != at) res.delivered++;
+    if (m.ttl - 1 <= 0) return;
+    Pending p{m, now + (coding ? HOLD_MS : 0) + 1 + rnd() % 4};
+    p.msg.ttl = m.ttl - 1;
+    if (coding && n.queue.size() >= QUEUE) p.due = now;   // pełna kolejka → forward od razu
+    n.queue.push_back(p);
+  };
+
+  for (uint32_t now = 0; now < end; ++now) {
+    // odbiór ramek z poprzedniej ms
+    for (const Tx &tx : air) {
+      for (int at = tx.from - 1; at <= tx.from + 1; at += 2) {
+        if (at < 0 || at >= nodes) continue;
+        if (!tx.coded) { accept(at, tx.from, tx.a, now); continue; }
+
+        Node &n = net[at];
+        uint8_t mac[6];
+        macOf(tx.from, mac);
+        n.coder.onHeard(mac, tx.frame.mid_a, now);
+        n.coder.onHeard(mac, tx.frame.mid_b, now);
+        const bool sa = seen(n, tx.frame.mid_a);
+        const bool sb = seen(n, tx.frame.mid_b);
+        if (sa == sb) { if (!sa) res.undecodable++; continue; }
+        Msg m{};
+        if (!n.coder.decode(tx.frame, tx.frame_len, sa ? tx.frame.mid_a : tx.frame.mid_b,
+                            reinterpret_cast<uint8_t*>(&m.body))) {
+          res.undecodable++;
+          continue;
+        }
+        m.mid = sa ? tx.frame.mid_b : tx.frame.mid_a;
+        m.ttl = sa ? tx.frame.ttl_b : tx.frame.ttl_a;
+        accept(at, tx.from, m, now);
+      }
+    }
+    air.clear();
+
+    // końce łańcucha nadają naprzemiennie
+    if (now % interval == 0 && now / interval < uint32_t(messages)) {
+      const int src = (now / interval) % 2 ? nodes - 1 : 0;
+      Msg m{};
+      snprintf(m.body.sender, sizeof(m.body.sender), "02:00:00:00:00:%02u", unsigned(src) % 100u);
+      strcpy(m.body.type, src ? "cmd" : "data");
+      strcpy(m.body.topic, src ? "ctrl/set" : "sensor/temp");
+      for (size_t k = 0; k < payload && k < sizeof(m.body.payload) - 1; ++k) {
+        m.body.payload[k] = char('a' + rnd() % 26);
+      }
+      m.mid = mid_seq++;
+      m.ttl = nodes;
+      Node &n = net[src];
+      n.seen.push_back(m.mid);
+      if (coding) n.coder.remember(m.mid, reinterpret_cast<const uint8_t*>(&m.body));
+      res.expected++;
+      Tx tx{};
+      tx.a = m;
+      send(src, tx);
+    }
+
+    // loop(): wysłanie odroczonych forwardów (jak MeshLib::_flushForwards)
+    for (int at = 0; at < nodes; ++at) {
+      Node &n = net[at];
+      for (size_t i = 0; i < n.queue.size();) {
+        if (int32_t(now - n.queue[i].due) < 0) { ++i; continue; }
+        const Msg a = n.queue[i].msg;
+        n.queue.erase(n.queue.begin() + i);
+
+        Tx tx{};
+        tx.a = a;
+        if (coding) {
+          for (size_t j = 0; j < n.queue.size(); ++j) {
+            const Msg &b = n.queue[j].msg;
+            if (!n.coder.canCombine(a.mid, b.mid, now)) continue;
+            tx.frame_len = MeshNetCoder::encode(tx.frame,
+                a.mid, int8_t(a.ttl), reinterpret_cast<const uint8_t*>(&a.body),
+                b.mid, int8_t(b.ttl), reinterpret_cast<const uint8_t*>(&b.body));
+            if (MeshRateLimiter::airtimeUs(tx.frame_len, RATE_KBPS) <
+                MeshRateLimiter::airtimeUs(frameLen(a), RATE_KBPS) +
+                MeshRateLimiter::airtimeUs(frameLen(b), RATE_KBPS)) {
+              tx.coded = true;
+              n.queue.erase(n.queue.begin() + j);
+              if (j < i) --i;
+            }
+            break;
+          }
+        }
+        send(at, tx);
+      }
+    }
+    air.swap(next_air);
+  }
+  return res;
+}
+
+// ================== MAIN ==================
+
+// load > 100% = więcej airtime niż czasu; w prawdziwym kanale kolizje
+static void report(const char *name, const Result &r, double duration_ms) {
+  printf("%-10s %6zu tx (%zu coded)  airtime %8.1f ms (load %3.0f%%)  delivered %zu/%zu  undecodable %zu\n",
+         name, r.tx_plain + r.tx_coded, r.tx_coded, r.airtime_us / 1000.0,
+         r.airtime_us / 10.0 / duration_ms, r.delivered, r.expected, r.undecodable);
+}
+
+int main(int argc, char **argv) {
+  const int nodes       = argc > 1 ? atoi(argv[1]) : 5;
+  const int messages    = argc > 2 ? atoi(argv[2]) : 200;
+  const int interval    = argc > 3 ? atoi(argv[3]) : 20;
+  const int payload     = argc > 4 ? atoi(argv[4]) : 40;
+  legacy_frames         = argc > 5 && atoi(argv[5]) != 0;
+  if (nodes < 3 || nodes > 99 || messages < 1 || interval < 1 || payload < 0 || payload > 139) {
+    fprintf(stderr, "usage: meshnc [nodes=5 (3..99)] [messages=200] [interval_ms=20] "
+                    "[payload=40 (0..139)] [legacy=0]\n");
+    return 2;
+  }
+
+  const Result plain = simulate(nodes, messages, uint32_t(interval), size_t(payload), false);
+  const Result coded = simulate(nodes, messages, uint32_t(interval), size_t(payload), true);
+
+  printf("chain of %d nodes, %d messages, every %d ms, payload %d B, %s frames\n",
+         nodes, messages, interval, payload, legacy_frames ? "legacy" : "compact");
+  const double duration_ms = double(messages) * interval;
+  report("no coding", plain, duration_ms);
+  report("coding", coded, duration_ms);
+  const size_t tp = plain.tx_plain, tc = coded.tx_plain + coded.tx_coded;
+  printf("saved      %5.1f%% transmissions, %5.1f%% airtime\n",
+         tp ? 100.0 * (double(tp) - double(tc)) / double(tp) : 0.0,
+         plain.airtime_us ? 100.0 * (double(plain.airtime_us) - double(coded.airtime_us)) /
+                            double(plain.airtime_us) : 0.0);
+  return (coded.delivered == coded.expected && plain.delivered == plain.expected) ? 0 : 1;
+}